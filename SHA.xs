@@ -13,6 +13,18 @@
 	#define SvPVbyte SvPV
 #endif
 
+#ifndef SvUTF8
+	#define SvUTF8(sv)	0
+#endif
+
+#ifndef SvPV_nomg
+	#define SvPV_nomg	SvPV
+#endif
+
+#ifndef dXSTARG
+	#define dXSTARG		SV *targ = sv_newmortal()
+#endif
+
 #ifndef dTHX
 	#define pTHX_
 	#define aTHX_
@@ -33,6 +45,11 @@
 #endif
 
 #include "src/sha.c"
+#include "src/shaio.c"
+#include "src/shatree.c"
+#include "src/shatar.c"
+#include "src/shaafalg.c"
+#include "src/shaindex.c"
 
 static const int ix2alg[] =
 	{1,1,1,224,224,224,256,256,256,384,384,384,512,512,512,
@@ -42,16 +59,211 @@ static const int ix2alg[] =
 #define INT2PTR(p, i) (p) (i)
 #endif
 
-#define MAX_WRITE_SIZE 16384
 #define IO_BUFFER_SIZE 4096
 
+	/* largest byte count per shawrite call: its length counter lenll
+	 * is 32 bits wide and carries into lenlh at most once per call, so
+	 * the bit count must stay below 2^32; rounded down to a whole
+	 * number of 1024-bit blocks */
+
+#define MAX_DIRECT_SIZE	((STRLEN) ((SHA32_MAX >> 3) & ~127UL))
+
+	/* Objects created by newSHA/clone carry PERL_MAGIC_ext magic
+	 * pointing at their state, which lets getSHA validate them with
+	 * one magic-chain lookup instead of an @ISA walk */
+
+#ifdef mg_findext
+	#define SHA_MAGIC_TAG
+static MGVTBL vtbl_sha;
+#endif
+
+static void tagSHA(pTHX_ SV *ref, SHA *state)
+{
+#ifdef SHA_MAGIC_TAG
+	sv_magicext(SvRV(ref), NULL, PERL_MAGIC_ext, &vtbl_sha,
+		(const char *) state, 0);
+#endif
+}
+
 static SHA *getSHA(pTHX_ SV *self)
 {
+#ifdef SHA_MAGIC_TAG
+	MAGIC *mg;
+
+	if (SvROK(self) && SvTYPE(SvRV(self)) >= SVt_PVMG &&
+		(mg = mg_findext(SvRV(self), PERL_MAGIC_ext, &vtbl_sha)))
+		return((SHA *) mg->mg_ptr);
+#endif
 	if (!sv_isobject(self) || !sv_derived_from(self, "Digest::SHA"))
 		return(NULL);
 	return INT2PTR(SHA *, SvIV(SvRV(self)));
 }
 
+/* addbytes: appends len bytes to the digest state, in direct writes of
+ * at most MAX_DIRECT_SIZE bytes so the length counter carries correctly */
+static void addbytes(SHA *state, UCHR *data, STRLEN len)
+{
+	while (len > MAX_DIRECT_SIZE) {
+		shawrite(data, (ULNG) MAX_DIRECT_SIZE << 3, state);
+		data += MAX_DIRECT_SIZE;
+		len  -= MAX_DIRECT_SIZE;
+	}
+	shawrite(data, (ULNG) len << 3, state);
+}
+
+	/* ASCII runs at least this long in UTF-8 input are hashed in
+	 * place; shorter ones are decoded along with their neighbours */
+
+#define UTF8_DIRECT_RUN	64
+
+/* addutf8: appends the byte string whose UTF-8 encoding is data, read
+ * in place (as SvPVbyte would, but without downgrading the caller's
+ * scalar); croaks on characters that don't fit in a byte, before any
+ * of the string reaches the digest state */
+static void addutf8(pTHX_ SHA *state, UCHR *data, STRLEN len)
+{
+	UCHR *end = data + len;
+	UCHR *run;
+	STRLEN n = 0;
+	UCHR buf[IO_BUFFER_SIZE];
+
+	for (run = data; run < end; run++)
+		if (*run >= 0x80) {
+			if ((run[0] & 0xfe) != 0xc2 || run + 1 == end ||
+				(run[1] & 0xc0) != 0x80)
+				croak("Wide character in subroutine entry");
+			run++;
+		}
+	while (data < end) {
+		for (run = data; data < end && *data < 0x80; data++)
+			;
+		if (data - run >= UTF8_DIRECT_RUN) {
+			shawrite(buf, (ULNG) n << 3, state), n = 0;
+			addbytes(state, run, (STRLEN) (data - run));
+		}
+		else
+			for (; run < data; run++) {
+				if (n == sizeof(buf))
+					shawrite(buf, (ULNG) n << 3, state), n = 0;
+				buf[n++] = *run;
+			}
+		for (; data < end && *data >= 0x80; data += 2) {
+			if (n == sizeof(buf))
+				shawrite(buf, (ULNG) n << 3, state), n = 0;
+			buf[n++] = (UCHR) (((data[0] & 0x03) << 6) |
+				(data[1] & 0x3f));
+		}
+	}
+	shawrite(buf, (ULNG) n << 3, state);
+}
+
+/* addsvnomg: appends the bytes of a Perl scalar whose get-magic (e.g.
+ * a tied FETCH) has already been called to the digest state */
+static void addsvnomg(pTHX_ SHA *state, SV *sv)
+{
+	UCHR *data;
+	STRLEN len;
+
+	data = (UCHR *) (SvPV_nomg(sv, len));
+	if (SvUTF8(sv)) {
+#ifndef EBCDIC
+		addutf8(aTHX_ state, data, len);
+		return;
+#else
+		sv = sv_2mortal(newSVpvn((char *) data, len));
+		SvUTF8_on(sv);
+		data = (UCHR *) (SvPVbyte(sv, len));
+#endif
+	}
+	addbytes(state, data, len);
+}
+
+/* addsv: appends the bytes of a Perl scalar to the digest state */
+static void addsv(pTHX_ SHA *state, SV *sv)
+{
+	SvGETMAGIC(sv);
+	addsvnomg(aTHX_ state, sv);
+}
+
+/* svbytes: like SvPVbyte, but downgrades a copy of a UTF-8 scalar */
+static char *svbytes(pTHX_ SV *sv, STRLEN *len)
+{
+	char *p = SvPV(sv, *len);
+	SV *tmp;
+
+	if (!SvUTF8(sv))
+		return(p);
+	tmp = sv_2mortal(newSVpvn(p, *len));
+	SvUTF8_on(tmp);
+	return(SvPVbyte(tmp, *len));
+}
+
+#ifdef SHA_POSIX_IO
+
+static SHAJOB *getSHAJOB(pTHX_ SV *self)
+{
+	if (!sv_isobject(self) || !sv_derived_from(self, "Digest::SHA::Async"))
+		return(NULL);
+	return INT2PTR(SHAJOB *, SvIV(SvRV(self)));
+}
+
+#endif
+
+static SHAINDEX *getSHAINDEX(pTHX_ SV *self)
+{
+	if (!sv_isobject(self) || !sv_derived_from(self, "Digest::SHA::Index"))
+		return(NULL);
+	return INT2PTR(SHAINDEX *, SvIV(SvRV(self)));
+}
+
+/* afalgsv: computes digest of args via AF_ALG if worthwhile; returns
+ * 0 on success, or -1 if the built-in transforms should be used */
+static int afalgsv(pTHX_ SHA *s, SV **args, int n)
+{
+#ifdef SHA_AFALG
+	int i, op, err;
+	UCHR *data;
+	STRLEN len, total = 0;
+
+	for (i = 0; i < n; i++) {
+		(void) SvPV_nomg(args[i], len);
+		if (SvUTF8(args[i]))
+			return(-1);
+		total += len;
+	}
+	if (total < AFALG_MIN_SIZE || (op = afalgbegin(s)) < 0)
+		return(-1);
+	for (i = 0; i < n; i++) {
+		data = (UCHR *) (SvPV_nomg(args[i], len));
+		if (afalgsend(op, data, len) < 0) {
+			close(op);
+			return(-1);
+		}
+	}
+	err = afalgfinish(op, s);
+	close(op);
+	return(err);
+#else
+	(void) s, (void) args, (void) n;
+	return(-1);
+#endif
+}
+
+/* shasv: computes the digest of args, calling the get-magic of each
+ * argument just once */
+static void shasv(pTHX_ SHA *s, SV **args, int n)
+{
+	int i;
+
+	for (i = 0; i < n; i++)
+		SvGETMAGIC(args[i]);
+	if (afalgsv(aTHX_ s, args, n) < 0) {
+		for (i = 0; i < n; i++)
+			addsvnomg(aTHX_ s, args[i]);
+		shafinish(s);
+	}
+}
+
 MODULE = Digest::SHA		PACKAGE = Digest::SHA
 
 PROTOTYPES: ENABLE
@@ -85,7 +297,9 @@ CODE:
 	}
 	RETVAL = newSV(0);
 	sv_setref_pv(RETVAL, classname, (void *) state);
+	tagSHA(aTHX_ RETVAL, state);
 	SvREADONLY_on(SvRV(RETVAL));
+	SHA_PROBE2(new, state, alg);
 OUTPUT:
 	RETVAL
 
@@ -101,6 +315,7 @@ CODE:
 	Newx(clone, 1, SHA);
 	RETVAL = newSV(0);
 	sv_setref_pv(RETVAL, sv_reftype(SvRV(self), 1), (void *) clone);
+	tagSHA(aTHX_ RETVAL, clone);
 	SvREADONLY_on(SvRV(RETVAL));
 	Copy(state, clone, 1, SHA);
 OUTPUT:
@@ -112,7 +327,7 @@ DESTROY(s)
 CODE:
 	Safefree(s);
 	
-SV *
+void
 sha1(...)
 ALIAS:
 	Digest::SHA::sha1 = 0
@@ -137,38 +352,26 @@ ALIAS:
 	Digest::SHA::sha512256_hex = 19
 	Digest::SHA::sha512256_base64 = 20
 PREINIT:
-	int i;
-	UCHR *data;
+	dXSTARG;
 	STRLEN len;
 	SHA sha;
 	char *result;
-CODE:
+PPCODE:
 	if (!shainit(&sha, ix2alg[ix]))
 		XSRETURN_UNDEF;
-	for (i = 0; i < items; i++) {
-		data = (UCHR *) (SvPVbyte(ST(i), len));
-		while (len > MAX_WRITE_SIZE) {
-			shawrite(data, MAX_WRITE_SIZE << 3, &sha);
-			data += MAX_WRITE_SIZE;
-			len  -= MAX_WRITE_SIZE;
-		}
-		shawrite(data, len << 3, &sha);
-	}
-	shafinish(&sha);
-	len = 0;
+	shasv(aTHX_ &sha, &ST(0), items);
 	if (ix % 3 == 0) {
 		result = (char *) shadigest(&sha);
 		len = sha.digestlen;
 	}
-	else if (ix % 3 == 1)
-		result = shahex(&sha);
-	else
-		result = shabase64(&sha);
-	RETVAL = newSVpv(result, len);
-OUTPUT:
-	RETVAL
+	else {
+		result = ix % 3 == 1 ? shahex(&sha) : shabase64(&sha);
+		len = strlen(result);
+	}
+	sv_setpvn(TARG, result, len);
+	XPUSHTARG;
 
-SV *
+void
 hmac_sha1(...)
 ALIAS:
 	Digest::SHA::hmac_sha1 = 0
@@ -193,40 +396,143 @@ ALIAS:
 	Digest::SHA::hmac_sha512256_hex = 19
 	Digest::SHA::hmac_sha512256_base64 = 20
 PREINIT:
+	dXSTARG;
 	int i;
 	UCHR *key = (UCHR *) "";
-	UCHR *data;
 	STRLEN len = 0;
 	HMAC hmac;
 	char *result;
-CODE:
+PPCODE:
 	if (items > 0) {
-		key = (UCHR *) (SvPVbyte(ST(items-1), len));
+		key = (UCHR *) (svbytes(aTHX_ ST(items-1), &len));
 	}
 	if (hmacinit(&hmac, ix2alg[ix], key, len) == NULL)
 		XSRETURN_UNDEF;
-	for (i = 0; i < items - 1; i++) {
-		data = (UCHR *) (SvPVbyte(ST(i), len));
-		while (len > MAX_WRITE_SIZE) {
-			hmacwrite(data, MAX_WRITE_SIZE << 3, &hmac);
-			data += MAX_WRITE_SIZE;
-			len  -= MAX_WRITE_SIZE;
-		}
-		hmacwrite(data, len << 3, &hmac);
-	}
+	for (i = 0; i < items - 1; i++)
+		addsv(aTHX_ &hmac.isha, ST(i));
 	hmacfinish(&hmac);
-	len = 0;
 	if (ix % 3 == 0) {
 		result = (char *) hmacdigest(&hmac);
 		len = hmac.digestlen;
 	}
-	else if (ix % 3 == 1)
-		result = hmachex(&hmac);
-	else
-		result = hmacbase64(&hmac);
-	RETVAL = newSVpv(result, len);
-OUTPUT:
-	RETVAL
+	else {
+		result = ix % 3 == 1 ? hmachex(&hmac) : hmacbase64(&hmac);
+		len = strlen(result);
+	}
+	sv_setpvn(TARG, result, len);
+	XPUSHTARG;
+
+void
+digest_into(target, alg, ...)
+	SV *	target
+	SV *	alg
+PREINIT:
+	int a;
+	int fmt;
+	STRLEN len;
+	char *p;
+	char *end;
+	char *result;
+	SHA sha;
+PPCODE:
+	p = SvPV(alg, len);
+	end = p + len;
+	fmt = 0;
+	if ((result = strrchr(p, '_')) != NULL) {
+		if (strEQ(result, "_hex"))
+			fmt = 1;
+		else if (strEQ(result, "_base64"))
+			fmt = 2;
+		if (fmt)
+			end = result;
+	}
+
+		/* as in new(): the digits of the name select the algorithm */
+
+	for (a = 0; p < end && a < 1000000; p++)
+		if (isDIGIT(*p))
+			a = a * 10 + (*p - '0');
+	if (!shainit(&sha, a))
+		XSRETURN_UNDEF;
+	shasv(aTHX_ &sha, &ST(2), items - 2);
+	if (fmt == 0) {
+		result = (char *) shadigest(&sha);
+		len = sha.digestlen;
+	}
+	else {
+		result = fmt == 1 ? shahex(&sha) : shabase64(&sha);
+		len = strlen(result);
+	}
+	sv_setpvn_mg(target, result, len);
+	XSRETURN(1);
+
+void
+_merkle(alg, leaves, leafpfx, nodepfx, idx)
+	int	alg
+	SV *	leaves
+	SV *	leafpfx
+	SV *	nodepfx
+	IV	idx
+PREINIT:
+	AV *av;
+	SV **svp;
+	ULNG i, n;
+	UINT j, nproof, dlen;
+	STRLEN len, lpfxlen = 0, npfxlen = 0;
+	UCHR *data, *lpfx = NULL, *npfx = (UCHR *) "";
+	UCHR *buf;
+	UCHR proof[SHA_TREE_MAX_DEPTH * (SHA_MAX_DIGEST_BITS/8)];
+	SHA sha;
+	SHATREE tree;
+PPCODE:
+	if (!SvROK(leaves) || SvTYPE(SvRV(leaves)) != SVt_PVAV)
+		XSRETURN_EMPTY;
+	if (!shainit(&tree.base, alg))
+		XSRETURN_EMPTY;
+	av = (AV *) SvRV(leaves);
+	n = (ULNG) (av_len(av) + 1);
+	dlen = tree.base.digestlen;
+	if (SvOK(leafpfx))
+		lpfx = (UCHR *) (SvPVbyte(leafpfx, lpfxlen));
+	if (SvOK(nodepfx))
+		npfx = (UCHR *) (SvPVbyte(nodepfx, npfxlen));
+	if (npfxlen > MAX_DIRECT_SIZE)
+		croak("Merkle node prefix is too long");
+	Newx(buf, (n ? n : 1) * dlen, UCHR);
+	SAVEFREEPV(buf);
+	for (i = 0; i < n; i++) {
+		svp = av_fetch(av, (I32) i, 0);
+		if (lpfx == NULL) {
+			len = 0;
+			data = (UCHR *) "";
+			if (svp && SvOK(*svp))
+				data = (UCHR *) (SvPVbyte(*svp, len));
+			if (len != dlen) {
+				croak("Merkle leaf %lu is not a %u-byte digest",
+					i, dlen);
+			}
+			Copy(data, buf + i * dlen, dlen, UCHR);
+			continue;
+		}
+		Copy(&tree.base, &sha, 1, SHA);
+		shawrite(lpfx, (ULNG) lpfxlen << 3, &sha);
+		if (svp && SvOK(*svp))
+			addsv(aTHX_ &sha, *svp);
+		shafinish(&sha);
+		Copy(digcpy(&sha), buf + i * dlen, dlen, UCHR);
+	}
+	if (n == 0) {
+		Copy(&tree.base, &sha, 1, SHA);
+		shafinish(&sha);
+		Copy(digcpy(&sha), buf, dlen, UCHR);
+	}
+	treeinit(&tree, npfx, (UINT) npfxlen);
+	nproof = treeroot(&tree, buf, n,
+		idx < 0 ? n : (ULNG) idx, proof);
+	EXTEND(SP, (IV) nproof + 1);
+	PUSHs(sv_2mortal(newSVpv((char *) buf, dlen)));
+	for (j = 0; j < nproof; j++)
+		PUSHs(sv_2mortal(newSVpv((char *) proof + j * dlen, dlen)));
 
 int
 hashsize(self)
@@ -248,21 +554,33 @@ add(self, ...)
 	SV *	self
 PREINIT:
 	int i;
-	UCHR *data;
-	STRLEN len;
 	SHA *state;
 PPCODE:
 	if ((state = getSHA(aTHX_ self)) == NULL)
 		XSRETURN_UNDEF;
-	for (i = 1; i < items; i++) {
-		data = (UCHR *) (SvPVbyte(ST(i), len));
-		while (len > MAX_WRITE_SIZE) {
-			shawrite(data, MAX_WRITE_SIZE << 3, state);
-			data += MAX_WRITE_SIZE;
-			len  -= MAX_WRITE_SIZE;
-		}
-		shawrite(data, len << 3, state);
-	}
+	for (i = 1; i < items; i++)
+		addsv(aTHX_ state, ST(i));
+	XSRETURN(1);
+
+void
+add_list(self, chunks)
+	SV *	self
+	SV *	chunks
+PREINIT:
+	AV *av;
+	SV **svp;
+	SSize_t i, n;
+	SHA *state;
+PPCODE:
+	if ((state = getSHA(aTHX_ self)) == NULL)
+		XSRETURN_UNDEF;
+	if (!SvROK(chunks) || SvTYPE(SvRV(chunks)) != SVt_PVAV)
+		XSRETURN_UNDEF;
+	av = (AV *) SvRV(chunks);
+	n = av_len(av) + 1;
+	for (i = 0; i < n; i++)
+		if ((svp = av_fetch(av, i, 0)) != NULL)
+			addsv(aTHX_ state, *svp);
 	XSRETURN(1);
 
 SV *
@@ -352,14 +670,156 @@ _addfilebin(self, f)
 PREINIT:
 	SHA *state;
 	int n;
+#ifdef SHA_POSIX_IO
+	int fd;
+#endif
+	double nbytes = 0.0;
+	unsigned long nreads = 0;
 	UCHR in[IO_BUFFER_SIZE];
 PPCODE:
 	if (!f || (state = getSHA(aTHX_ self)) == NULL)
 		XSRETURN_UNDEF;
-	while ((n = PerlIO_read(f, in, sizeof(in))) > 0)
+	SHA_PROBE3(addfile_start, state, state->alg, 0);
+#ifdef SHA_POSIX_IO
+
+		/* bypass PerlIO for sparse files, provided it holds no
+		 * read-ahead and applies no translation to the bytes */
+
+	if ((fd = PerlIO_fileno(f)) >= 0 && !PerlIO_isutf8(f) &&
+		PerlIO_tell(f) == (Off_t) lseek(fd, 0, SEEK_CUR) &&
+		shafdsparse(state, fd, &nbytes) >= 0) {
+		SHA_PROBE4(addfile_end, state, state->alg, (ULNG) nbytes, 0);
+		XSRETURN(1);
+	}
+#endif
+	while ((n = PerlIO_read(f, in, sizeof(in))) > 0) {
 		shawrite(in, (ULNG) n << 3, state);
+		nbytes += n, nreads++;
+	}
+	SHA_PROBE4(addfile_end, state, state->alg, (ULNG) nbytes, nreads);
 	XSRETURN(1);
 
+void
+_addtarbin(self, f)
+	SV *		self
+	PerlIO *	f
+PREINIT:
+	SHA *state;
+	SHATAR *t;
+	AV *members;
+	AV *member;
+	int n;
+	size_t used;
+	UCHR *p;
+	UCHR in[IO_BUFFER_SIZE];
+PPCODE:
+	if (!f || (state = getSHA(aTHX_ self)) == NULL)
+		XSRETURN_UNDEF;
+	if ((t = tarinit(state->alg)) == NULL)
+		XSRETURN_UNDEF;
+	members = (AV *) sv_2mortal((SV *) newAV());
+	while ((n = PerlIO_read(f, in, sizeof(in))) > 0) {
+		shawrite(in, (ULNG) n << 3, state);
+		for (p = in; n > 0; p += used, n -= (int) used) {
+			used = tarwrite(t, p, (size_t) n);
+			if (!t->ready)
+				continue;
+			shafinish(&t->member);
+			member = newAV();
+			av_push(member, newSVpv(t->name, 0));
+			av_push(member, newSVpv((char *) digcpy(&t->member),
+				t->member.digestlen));
+			av_push(members, newRV_noinc((SV *) member));
+			t->ready = 0;
+		}
+	}
+	n = tardone(t);
+	tarfree(t);
+	if (!n)
+		XSRETURN_UNDEF;
+	ST(0) = sv_2mortal(newRV_inc((SV *) members));
+	XSRETURN(1);
+
+#ifdef SHA_POSIX_IO
+
+SV *
+_addfileasync(self, fd)
+	SV *	self
+	int	fd
+PREINIT:
+	SHA *state;
+	SHAJOB *job;
+CODE:
+	if ((state = getSHA(aTHX_ self)) == NULL)
+		XSRETURN_UNDEF;
+	if ((job = shajobstart(state, fd)) == NULL)
+		XSRETURN_UNDEF;
+	job->owner = (void *) SvREFCNT_inc(SvRV(self));
+	RETVAL = newSV(0);
+	sv_setref_pv(RETVAL, "Digest::SHA::Async", (void *) job);
+	SvREADONLY_on(SvRV(RETVAL));
+OUTPUT:
+	RETVAL
+
+void
+_copyfd(self, in, out)
+	SV *	self
+	int	in
+	int	out
+PREINIT:
+	SHA *state;
+	int err;
+	double n;
+PPCODE:
+	if ((state = getSHA(aTHX_ self)) == NULL)
+		XSRETURN_EMPTY;
+	if ((err = afalgcopy(state, in, out, &n)) < 0)
+		if ((err = shafdcopy(state, in, out, &n)) == 0)
+			shafinish(state);
+	if (err != 0) {
+		errno = err;
+		XSRETURN_EMPTY;
+	}
+	EXTEND(SP, 2);
+	PUSHs(sv_2mortal(newSVnv((NV) n)));
+	PUSHs(sv_2mortal(newSVpv((char *) shadigest(state),
+		state->digestlen)));
+	sharewind(state);
+
+#endif
+
+int
+_afalg(...)
+CODE:
+	if (items > 0)
+		afalg_enabled = SvTRUE(ST(0)) ? 1 : 0;
+	RETVAL = afalg_enabled;
+OUTPUT:
+	RETVAL
+
+void
+_kernels(alg)
+	int	alg
+PREINIT:
+	int i;
+	const SHAKERNEL *k;
+PPCODE:
+	if ((k = shaselected(alg)) == NULL)
+		XSRETURN_EMPTY;
+	XPUSHs(sv_2mortal(newSVpv(k->name, 0)));
+	for (i = 0; (k = shakernel(alg, i)) != NULL; i++)
+		XPUSHs(sv_2mortal(newSVpv(k->name, 0)));
+	XPUSHs(sv_2mortal(newSViv(afalgusable(alg))));
+
+int
+_setkernel(alg, name)
+	int	alg
+	char *	name
+CODE:
+	RETVAL = shaselect(alg, name);
+OUTPUT:
+	RETVAL
+
 void
 _addfileuniv(self, f)
 	SV *		self
@@ -371,10 +831,14 @@ PREINIT:
 	UCHR *src, *dst;
 	UCHR in[IO_BUFFER_SIZE+1];
 	SHA *state;
+	double nbytes = 0.0;
+	unsigned long nreads = 0;
 PPCODE:
 	if (!f || (state = getSHA(aTHX_ self)) == NULL)
 		XSRETURN_UNDEF;
+	SHA_PROBE3(addfile_start, state, state->alg, 1);
 	while ((n = PerlIO_read(f, in+1, IO_BUFFER_SIZE)) > 0) {
+		nbytes += n, nreads++;
 		for (dst = in, src = in + 1; n; n--) {
 			c = *src++;
 			if (!cr) {
@@ -403,4 +867,152 @@ PPCODE:
 		in[0] = '\012';
 		shawrite(in, 1 << 3, state);
 	}
+	SHA_PROBE4(addfile_end, state, state->alg, (ULNG) nbytes, nreads);
 	XSRETURN(1);
+
+MODULE = Digest::SHA		PACKAGE = Digest::SHA::Async
+
+#ifdef SHA_POSIX_IO
+
+int
+is_done(job)
+	SHAJOB *	job
+CODE:
+	if (job == NULL)
+		XSRETURN_UNDEF;
+	RETVAL = shajobdone(job);
+OUTPUT:
+	RETVAL
+
+int
+fileno(job)
+	SHAJOB *	job
+CODE:
+	if (job == NULL)
+		XSRETURN_UNDEF;
+	RETVAL = job->ready[0];
+OUTPUT:
+	RETVAL
+
+SV *
+wait(job)
+	SHAJOB *	job
+PREINIT:
+	int err;
+CODE:
+	if (job == NULL)
+		XSRETURN_UNDEF;
+	if ((err = shajobwait(job)) < 0)
+		croak("Job was started by another process");
+	if (err != 0) {
+		errno = err;
+		croak("Read failed: %s", Strerror(err));
+	}
+	RETVAL = newRV_inc((SV *) job->owner);
+OUTPUT:
+	RETVAL
+
+void
+DESTROY(job)
+	SHAJOB *	job
+CODE:
+	shajobwait(job);
+	SvREFCNT_dec((SV *) job->owner);
+	shajobfree(job);
+
+#endif
+
+MODULE = Digest::SHA		PACKAGE = Digest::SHA::Index
+
+SV *
+_open(classname, path)
+	char *	classname
+	char *	path
+PREINIT:
+	SHAINDEX *x;
+CODE:
+	if ((x = idxopen(aTHX_ path)) == NULL)
+		XSRETURN_UNDEF;
+	RETVAL = newSV(0);
+	sv_setref_pv(RETVAL, classname, (void *) x);
+	SvREADONLY_on(SvRV(RETVAL));
+OUTPUT:
+	RETVAL
+
+SV *
+_sort(records, dlen)
+	SV *	records
+	unsigned int	dlen
+PREINIT:
+	UINT i;
+	STRLEN len;
+	size_t *table;
+	UCHR *data;
+	UCHR *p;
+CODE:
+	data = (UCHR *) (SvPVbyte_force(records, len));
+	if (dlen < 2 || dlen > SHA_MAX_DIGEST_BITS/8 || len % dlen)
+		XSRETURN_UNDEF;
+	Newx(table, IDX_BUCKETS + 1, size_t);
+	len = idxsort(data, len / dlen, dlen, table) * dlen;
+	SvCUR_set(records, len);
+	RETVAL = newSV(IDX_TABLEN);
+	SvPOK_only(RETVAL);
+	p = (UCHR *) SvPVX(RETVAL);
+	for (i = 0; i <= IDX_BUCKETS; i++) {
+		p = w32mem(p, (W32) ((table[i] >> 16) >> 16));
+		p = w32mem(p, (W32) (table[i] & SHA32_MAX));
+	}
+	SvCUR_set(RETVAL, IDX_TABLEN);
+	Safefree(table);
+OUTPUT:
+	RETVAL
+
+int
+contains(x, digest)
+	SHAINDEX *	x
+	SV *		digest
+PREINIT:
+	STRLEN len;
+	UCHR *data;
+	UCHR raw[SHA_MAX_DIGEST_BITS/8];
+CODE:
+	if (x == NULL)
+		XSRETURN_UNDEF;
+	data = (UCHR *) (SvPVbyte(digest, len));
+	if (len == 2 * (STRLEN) x->dlen) {
+		if (!idxhex(data, x->dlen, raw))
+			XSRETURN_UNDEF;
+		data = raw;
+	}
+	else if (len != x->dlen)
+		XSRETURN_UNDEF;
+	RETVAL = idxcontains(x, data);
+OUTPUT:
+	RETVAL
+
+NV
+count(x)
+	SHAINDEX *	x
+CODE:
+	if (x == NULL)
+		XSRETURN_UNDEF;
+	RETVAL = (NV) x->count;
+OUTPUT:
+	RETVAL
+
+int
+digestlen(x)
+	SHAINDEX *	x
+CODE:
+	if (x == NULL)
+		XSRETURN_UNDEF;
+	RETVAL = (int) x->dlen;
+OUTPUT:
+	RETVAL
+
+void
+DESTROY(x)
+	SHAINDEX *	x
+CODE:
+	idxclose(x);
@@ -14,6 +14,8 @@ require Exporter;
 require DynaLoader;
 @ISA = qw(Exporter DynaLoader);
 @EXPORT_OK = qw(
+	copy_and_hash	digest_into	kernels
+	merkle_proof	merkle_root
 	hmac_sha1	hmac_sha1_base64	hmac_sha1_hex
 	hmac_sha224	hmac_sha224_base64	hmac_sha224_hex
 	hmac_sha256	hmac_sha256_base64	hmac_sha256_hex
@@ -142,6 +144,178 @@ sub addfile {
 	$self;
 }
 
+sub addtar {
+	my ($self, $file) = @_;
+
+	my $fh = $file;
+	local *FH;
+	if (ref(\$file) eq 'SCALAR') {
+		$file eq '-' and open(FH, '< -')
+			or sysopen(FH, $file, O_RDONLY)
+				or _bail('Open failed');
+		$fh = *FH;
+	}
+	binmode($fh);
+	my $members = $self->_addtarbin($fh);
+	close(FH) if ref(\$file) eq 'SCALAR';
+	unless ($members) {
+		require Carp;
+		Carp::croak("Malformed or truncated tar archive");
+	}
+	@$members;
+}
+
+sub addfile_async {
+	my ($self, $file) = @_;
+
+		## Without POSIX descriptor I/O (e.g. on MSWin32 and VMS),
+		## hash the file now and return a job that is already done
+
+	unless (defined &_addfileasync) {
+		ref(\$file) eq 'SCALAR' ? $self->addfile($file, "b")
+			: $self->addfile($file);
+		return(bless(\$self, 'Digest::SHA::Async'));
+	}
+
+	my $fd;
+	local *FH;
+	if (ref(\$file) eq 'SCALAR') {
+		$file eq '-' and open(FH, '< -')
+			or sysopen(FH, $file, O_RDONLY)
+				or _bail('Open failed');
+		$fd = fileno(FH);
+	}
+	else { $fd = fileno($file) }
+	unless (defined $fd) {
+		require Errno;
+		$! = Errno::EBADF();
+		_bail('Open failed');
+	}
+
+		## The job reads from its own duplicate of the descriptor,
+		## so our copy may be closed as soon as the job has started
+
+	my $job = $self->_addfileasync($fd) or _bail('Open failed');
+	close(FH) if ref(\$file) eq 'SCALAR';
+	$job;
+}
+
+sub _fileno {
+	my $fh = shift;
+
+	return($fh) if ref(\$fh) eq 'SCALAR' && $fh =~ /^\d+$/;
+	fileno($fh);
+}
+
+sub copy_and_hash {
+	my ($in, $out, %opts) = @_;
+
+	my $self = __PACKAGE__->new($opts{alg}) or return;
+	my ($infd, $outfd) = (_fileno($in), _fileno($out));
+	unless (defined $infd && defined $outfd) {
+		require Errno;
+		$! = Errno::EBADF();
+		_bail("Copy failed");
+	}
+	return(_copyperl($self, $infd, $outfd)) unless defined &_copyfd;
+	my ($n, $digest) = $self->_copyfd($infd, $outfd);
+	_bail("Copy failed") unless defined $n;
+	($n, $digest);
+}
+
+	## Fallback for copy_and_hash without POSIX descriptor I/O
+
+sub _copyperl {
+	my ($self, $infd, $outfd) = @_;
+
+	local (*IN, *OUT);
+	open(IN, "<&$infd") && open(OUT, ">&$outfd") or _bail("Copy failed");
+	binmode(IN);
+	binmode(OUT);
+	my ($n, $k, $w, $buf) = (0, 0, 0, "");
+	while (($k = sysread(IN, $buf, 65536))) {
+		$self->add($buf);
+		for (my $off = 0; $off < $k; $off += $w) {
+			defined($w = syswrite(OUT, $buf, $k - $off, $off))
+				or _bail("Copy failed");
+		}
+		{ no integer; $n += $k }
+	}
+	_bail("Copy failed") unless defined $k;
+	close(IN);
+	close(OUT);
+	($n, $self->digest);
+}
+
+sub _merkleopts {
+	my %opts = @_;
+
+	my $alg = defined $opts{alg} ? $opts{alg} : 1;
+	$alg =~ s/\D+//g;
+	($alg, $opts{leaf_prefix}, $opts{node_prefix});
+}
+
+sub merkle_root {
+	my ($leaves, %opts) = @_;
+
+	my ($alg, $leafpfx, $nodepfx) = _merkleopts(%opts);
+	my ($root) = _merkle($alg, $leaves, $leafpfx, $nodepfx, -1);
+	$root;
+}
+
+sub merkle_proof {
+	my ($leaves, $index, %opts) = @_;
+
+	return unless ref($leaves) eq 'ARRAY';
+	return unless defined $index && $index =~ /^\d+$/;
+	return unless $index < @$leaves;
+	my ($alg, $leafpfx, $nodepfx) = _merkleopts(%opts);
+	my ($root, @path) = _merkle($alg, $leaves, $leafpfx, $nodepfx,
+		$index);
+	defined $root ? @path : ();
+}
+
+my @_algs = (1, 224, 256, 384, 512, 512224, 512256);
+
+sub kernels {
+	my %k;
+
+	for my $alg (@_algs) {
+		my ($selected, @available) = _kernels($alg) or next;
+		my $afalg = pop(@available);
+		$k{"sha$alg"} = {
+			selected	=> $selected,
+			available	=> \@available,
+			afalg		=> $afalg,
+		};
+	}
+	\%k;
+}
+
+	## Kernel overrides: a comma-separated list of "sha256=sched"
+	## or plain "sched" (every algorithm offering it), and "afalg=off"
+
+sub _envkernels {
+	my $spec = shift;
+
+	for (split(/[\s,]+/, $spec)) {
+		next unless length;
+		my ($alg, $name) = /=/ ? split(/=/, $_, 2) : (undef, $_);
+		if (defined $alg && $alg eq 'afalg') {
+			_afalg($name =~ /^(on|1|yes)$/i ? 1 : 0);
+			next;
+		}
+		my @alg = @_algs;
+		if (defined $alg) {
+			$alg =~ s/\D+//g;		# as in new()
+			@alg = ($alg);
+		}
+		my $n = grep { _setkernel($_, $name) } @alg;
+		warn("Digest::SHA: unknown kernel '$_' in " .
+			"PERL_DIGEST_SHA_KERNEL\n") unless $n;
+	}
+}
+
 sub getstate {
 	my $self = shift;
 
@@ -238,6 +412,17 @@ sub load {
 
 Digest::SHA->bootstrap($VERSION);
 
+	## Jobs returned by the synchronous addfile_async fallback
+
+unless (defined &Digest::SHA::Async::wait) {
+	*Digest::SHA::Async::is_done = sub { 1 };
+	*Digest::SHA::Async::fileno = sub { undef };
+	*Digest::SHA::Async::wait = sub { ${$_[0]} };
+}
+
+_envkernels($ENV{PERL_DIGEST_SHA_KERNEL})
+	if defined $ENV{PERL_DIGEST_SHA_KERNEL};
+
 1;
 __END__
 
@@ -261,6 +446,8 @@ In programs:
 	$digest = sha384_hex($data);
 	$digest = sha512_base64($data);
 
+	digest_into($digest, "sha256_hex", $data);	# reuse $digest
+
 		# Object-oriented
 
 	use Digest::SHA;
@@ -268,10 +455,16 @@ In programs:
 	$sha = Digest::SHA->new($alg);
 
 	$sha->add($data);		# feed data into stream
+	$sha->add_list(\@chunks);
 
 	$sha->addfile(*F);
 	$sha->addfile($filename);
 
+	$job = $sha->addfile_async($filename);	# hash in background
+	$sha = $job->wait;
+
+	@members = $sha->addtar($tarfile);	# [$name, $digest] pairs
+
 	$sha->add_bits($bits);
 	$sha->add_bits($data, $nbits);
 
@@ -283,6 +476,19 @@ In programs:
 	$digest = $sha->hexdigest;
 	$digest = $sha->b64digest;
 
+		# Copy a stream while hashing it
+
+	use Digest::SHA qw(copy_and_hash);
+
+	($nbytes, $digest) = copy_and_hash($in, $out, alg => 256);
+
+		# Merkle tree root and proof path
+
+	use Digest::SHA qw(merkle_root merkle_proof);
+
+	$root = merkle_root(\@leaves, alg => 256);
+	@path = merkle_proof(\@leaves, $index, alg => 256);
+
 From the command line:
 
 	$ shasum files
@@ -398,10 +604,68 @@ The following code illustrates the two cases:
 	$str2 = pack('U*', (0..256));
 	print sha1_hex($str2);		# croaks
 
-Be aware that the digest routines silently convert UTF-8 input into its
-equivalent byte sequence in the native encoding (cf. utf8::downgrade).
-This side effect influences only the way Perl stores the data internally,
-but otherwise leaves the actual value of the data intact.
+The digest routines and the I<add> methods decode UTF-8 input to its
+byte sequence as they hash it, reading the string in place.  The
+caller's scalar is therefore neither copied nor converted (cf.
+utf8::downgrade), and its internal representation is left exactly as
+it was.
+
+=head1 TRANSFORM KERNELS
+
+Some algorithms have more than one compiled implementation of their
+compression function, or I<kernel>.  All of them produce identical
+digests, but their speed differs by platform and compiler.  The
+function I<kernels> reports what is available:
+
+	$k = Digest::SHA::kernels();
+	print $k->{sha256}{selected};		# e.g. "c"
+	print "@{$k->{sha256}{available}}";	# e.g. "c sched"
+	print $k->{sha256}{afalg};		# 1 if AF_ALG serves SHA-256
+
+The result has one entry per algorithm ("sha1", "sha224", and so on).
+I<selected> is the kernel used by newly created objects and by the
+functional interface, I<available> lists every compiled kernel with
+the default first, and I<afalg> tells whether large one-shot inputs
+are handed to the Linux kernel (see below).
+
+For A/B comparisons, the environment variable PERL_DIGEST_SHA_KERNEL
+forces a choice when the module is loaded.  It holds a comma-separated
+list of I<alg=kernel> settings, bare kernel names (applied to every
+algorithm offering them), and I<afalg=off>:
+
+	PERL_DIGEST_SHA_KERNEL=sha256=sched,afalg=off shasum -a 256 file
+
+Algorithms sharing a compression function (SHA-224 and SHA-256; and
+SHA-384, SHA-512, SHA-512/224 and SHA-512/256) share the selection.
+Running "make selftest" checks every compiled kernel against the
+standard test vectors and against the default kernel on random input.
+
+=head1 LINUX KERNEL CRYPTO API
+
+On Linux, Digest::SHA can hand work to the kernel's crypto API through
+an AF_ALG "hash" socket, which uses whatever accelerated SHA-1/224/256/
+384/512 implementation the kernel provides.  Because the kernel returns
+only final digests, never intermediate states, the backend is used
+only where a complete message is hashed in one call: the functional
+I<sha*()> routines for inputs of 64 KiB or more, and I<copy_and_hash>,
+which then moves data with I<splice(2)> and I<tee(2)> so that it is
+copied and hashed without ever entering user space.
+
+Whenever the backend is unavailable (e.g. in containers lacking AF_ALG
+support) or inapplicable, the built-in transforms are used instead,
+with identical results.  The script F<examples/afalgbench> compares
+the throughput of both on the local machine.
+
+=head1 TRACING
+
+Where F<E<lt>sys/sdt.hE<gt>> is available at build time, Digest::SHA
+contains static (USDT) tracepoints under the provider name
+"digest_sha": I<new>, I<write>, I<finish>, I<hmac_init>,
+I<addfile_start>, and I<addfile_end>.  Each compiles to a single no-op
+instruction until a tracer attaches, so hashing latency and throughput
+can be examined in production processes without a debug build.  The
+script F<examples/shatrace> runs ready-made bpftrace programs against
+these tracepoints.
 
 =head1 NIST STATEMENT ON SHA-1
 
@@ -507,6 +771,83 @@ the padding characters typical of Base64 encodings.  This omission is
 deliberate, and is done to maintain compatibility with the family of
 CPAN Digest modules.  See L</"PADDING OF BASE64 DIGESTS"> for details.
 
+=item B<copy_and_hash($in, $out, alg =E<gt> $alg)>
+
+Copies everything readable from I<$in> to I<$out>, computing the
+SHA digest of the data in the same pass, and returns a two-element
+list containing the number of bytes copied and the digest encoded
+as a binary string.  The I<alg> option accepts the same values as
+I<new>, and defaults to SHA-1.
+
+Both I<$in> and I<$out> may be filehandles or numeric file descriptors.
+The copy works directly on the underlying descriptors through a single
+native buffer, so the data never passes through Perl scalars.  Any
+output already buffered in a Perl filehandle for I<$out> should be
+flushed beforehand.  Likewise, data already read ahead into the
+buffer of a Perl filehandle for I<$in> (e.g. by an earlier I<readline>
+or I<read>) is neither copied nor hashed: the copy starts at the
+descriptor's current position.  The routine croaks if a read or write
+fails.
+Where POSIX descriptor I/O is unavailable (e.g. MSWin32 and VMS), the
+data is copied through Perl instead.
+
+=item B<digest_into($target, $alg, @data)>
+
+Logically joins the arguments into a single string, and stores its
+SHA-I<$alg> digest in I<$target>, which is also returned.  I<$alg>
+takes the same values as in I<new> ("256", "sha256", etc.), and a
+suffix of "_hex" or "_base64" selects the encoded forms.  For
+example:
+
+	digest_into($digest, "sha256_hex", $data);
+
+is equivalent to
+
+	$digest = sha256_hex($data);
+
+except that no new scalar is created for the result: the digest is
+written into the existing buffer of I<$target>, so a loop that hashes
+many messages into the same variable performs no memory allocation at
+all.  Returns undef if I<$alg> is unrecognized.
+
+=item B<merkle_root(\@leaves, %options)>
+
+Returns the root of the binary Merkle tree built over I<@leaves>,
+encoded as a binary string.  Each internal node is the digest of
+its left and right children concatenated; at every level, an unpaired
+last node is promoted unchanged to the next level.  The following
+options are recognized:
+
+	alg		algorithm, as accepted by new (default: 1)
+	leaf_prefix	if defined, each leaf is first hashed as
+			digest(leaf_prefix . leaf)
+	node_prefix	prepended to each pair of children (default: "")
+
+Without I<leaf_prefix>, each element of I<@leaves> must already be a
+binary digest of the selected algorithm; otherwise the routine croaks.
+The root of an empty list is the digest of the empty string.  Setting
+I<leaf_prefix> to "\x00" and I<node_prefix> to "\x01" yields the
+Merkle Tree Hash of RFC 6962 (Certificate Transparency).
+
+When the prefix and both children exactly fill one input block (e.g.
+SHA-256 with no I<node_prefix>), the constant padding block and its
+message schedule are prepared once per call rather than once per
+internal node.
+
+=item B<merkle_proof(\@leaves, $index, %options)>
+
+Returns the audit path for leaf I<$index>: the list of sibling digests
+encountered while walking from that leaf up to the root, nearest
+first.  Levels at which the node is promoted without a sibling
+contribute nothing to the path.  Options are the same as for
+I<merkle_root>.  An empty list is returned if I<$index> is out of range.
+
+=item B<kernels>
+
+Returns a reference to a hash describing the compiled transform
+kernels of each algorithm, and whether the Linux kernel crypto API
+serves it.  See L</"TRANSFORM KERNELS">.
+
 =back
 
 I<OOP style>
@@ -560,6 +901,13 @@ statements have the same effect:
 
 The return value is the updated object itself.
 
+=item B<add_list(\@chunks)>
+
+Same as I<add(@chunks)>, but takes a reference to the array of
+data, so that a large batch of buffers (e.g. lines of a log) can be
+consumed in a single call without flattening the array onto the Perl
+stack.  The return value is the updated object itself.
+
 =item B<add_bits($data, $nbits)>
 
 =item B<add_bits($bits)>
@@ -624,6 +972,76 @@ a convenient way to calculate the digest values of partial-byte data
 by using files, rather than having to write separate programs employing
 the I<add_bits> method.
 
+On systems supporting I<SEEK_DATA> and I<SEEK_HOLE>, the holes of
+sparse files read in the default or "b" mode are hashed as runs of
+zero bytes without being read at all, so that hashing a mostly-empty
+disk image costs no more I/O than reading its allocated data.  The
+digest is of course identical.
+
+=item B<addtar($filename)>
+
+=item B<addtar(*FILE)>
+
+Reads a tar archive, appending all of its bytes to the current state
+exactly as I<addfile> would in binary mode, and at the same time
+computes the digest of each regular file stored in the archive, using
+the same algorithm.  Nothing is extracted or buffered: the archive is
+read once, in a single pass, so it may equally come from a pipe.
+
+Returns a list of array references, one per regular file and in
+archive order, each holding the member's name and its binary digest:
+
+	for ($sha->addtar("layer.tar")) {
+		my ($name, $digest) = @$_;
+		print unpack("H*", $digest), "  $name\n";
+	}
+	print $sha->hexdigest, "  layer.tar\n";
+
+POSIX ustar and pax archives are understood, as are the GNU long-name
+and large-file extensions.  Directories, links, and other special
+members produce no entries.  Compressed archives must be decompressed
+first, e.g. by passing the output of I<gzip -dc> as I<FILE>.  The
+method croaks if the archive is malformed or ends in the middle of a
+member.
+
+=item B<addfile_async($filename)>
+
+=item B<addfile_async(*FILE)>
+
+Starts reading I<$filename> (or the descriptor underlying I<FILE>)
+on a background thread, and returns a job handle immediately.  The
+data is hashed outside the Perl interpreter, so the calling program
+remains free to do other work, including running further jobs
+concurrently.  When the job finishes, its state is copied back into
+the Digest::SHA object, exactly as if I<addfile> had been called.
+
+The job handle supports three methods:
+
+	$job->is_done		# true once hashing has finished
+	$job->fileno		# descriptor that becomes readable when done
+	$job->wait		# blocks until done; returns the object
+
+The descriptor returned by I<fileno> is intended for event loops
+such as AnyEvent or IO::Async: watch it for readability, then call
+I<wait> to collect the result without blocking.  I<wait> croaks if
+the background read failed.  Destroying a job handle also waits for
+its completion.
+
+While a job is outstanding, the object should not otherwise be used,
+since its state will be overwritten when the job completes.  Data
+already buffered in a Perl filehandle is not seen by the job, which
+reads the underlying descriptor directly and always operates in
+binary mode.  On platforms without POSIX threads, the job runs to
+completion before I<addfile_async> returns.
+
+A job belongs to the process that started it.  In a child forked
+while the job is outstanding, the handle reports I<is_done>, I<wait>
+croaks, and destroying it merely closes the child's copies of the
+job's descriptors; the parent's job is unaffected.  Where POSIX descriptor
+I/O is unavailable altogether (e.g. MSWin32 and VMS), the file is read
+through Perl, the job is complete on return, and I<fileno> returns
+undef.
+
 =item B<getstate>
 
 Returns a string containing a portable, human-readable representation
@@ -0,0 +1,200 @@
+package Digest::SHA::Index;
+
+require 5.003000;
+
+use strict;
+use warnings;
+use vars qw($VERSION);
+use Fcntl qw(O_RDONLY O_WRONLY O_CREAT O_TRUNC);
+use Digest::SHA ();
+
+$VERSION = '5.98';
+
+# Digests are accepted in binary or hexadecimal form; the valid lengths
+# (in bytes) are those of SHA-1/224/256/384/512
+
+my %isdlen = map { $_ => 1 } (20, 28, 32, 48, 64);
+
+sub _croak {
+	require Carp;
+	Carp::croak(@_);
+}
+
+sub _bail {
+	my $msg = shift;
+
+	$msg .= ": $!" if $!;
+	_croak($msg);
+}
+
+sub _raw {
+	my $d = shift;
+
+	return(pack("H*", $d)) if $d =~ /^[0-9a-fA-F]+$/ &&
+		length($d) % 2 == 0 && $isdlen{length($d) / 2};
+	return($d) if $isdlen{length($d)};
+	undef;
+}
+
+sub new {
+	my ($class, $file) = @_;
+
+	$class->_open($file);
+}
+
+sub build {
+	my ($class, $file, $src) = @_;
+
+	my ($dlen, $records, $n) = (undef, "", 0);
+	my $add = sub {
+		my $d = _raw(shift);
+		defined $d or _croak("Malformed digest at item " . ($n+1));
+		$dlen = length($d) unless defined $dlen;
+		length($d) == $dlen or _croak("Mixed digest lengths");
+		$records .= $d;
+		$n++;
+	};
+
+	if (ref($src) eq 'ARRAY') {
+		$add->($_) for @$src;
+	}
+	else {
+
+		## Read digests from a file or filehandle: the first run
+		## of hex digits of a valid length on each line is used,
+		## which also covers CSV lists such as the NSRL's
+
+		local *FH;
+		my $fh = $src;
+		if (ref(\$src) eq 'SCALAR') {
+			sysopen(FH, $src, O_RDONLY) or _bail("Open failed");
+			$fh = \*FH;
+		}
+		while (defined(my $line = <$fh>)) {
+			my ($d) = grep { $isdlen{length($_) / 2} }
+				$line =~ /\b([0-9a-fA-F]{40,128})\b/g;
+			$add->($d) if defined $d;
+		}
+	}
+	$dlen = 20 unless defined $dlen;
+
+	my $table = _sort($records, $dlen) or _croak("Sort failed");
+	my $count = length($records) / $dlen;
+
+	local *OUT;
+	sysopen(OUT, $file, O_WRONLY|O_CREAT|O_TRUNC) or _bail("Open failed");
+	binmode(OUT);
+	{
+		no integer;
+		print OUT "DSHAIDX1", pack("NNNN", $dlen, 0,
+			int($count / 4294967296), $count % 4294967296)
+			or _bail("Write failed");
+	}
+	print OUT $table, $records or _bail("Write failed");
+	close(OUT) or _bail("Write failed");
+
+	$class->new($file);
+}
+
+1;
+__END__
+
+=head1 NAME
+
+Digest::SHA::Index - Memory-mapped set of known SHA digests
+
+=head1 SYNOPSIS
+
+	use Digest::SHA::Index;
+
+		# Build an index from digests (binary or hex), or
+		# from a file listing one digest per line
+
+	$idx = Digest::SHA::Index->build("known.idx", \@digests);
+	$idx = Digest::SHA::Index->build("known.idx", "NSRLFile.txt");
+
+		# Look up digests
+
+	$idx = Digest::SHA::Index->new("known.idx");
+	print "known\n" if $idx->contains($sha->digest);
+
+From the command line:
+
+	$ shasum -k known.idx files
+
+=head1 DESCRIPTION
+
+Digest::SHA::Index answers set-membership queries against large
+collections of SHA digests, such as the hundreds of millions of
+entries in a known-file reference set, without loading them into a
+Perl hash.
+
+An index is a single binary file holding the digests in sorted order,
+preceded by a table that locates every group of digests sharing the
+same first two bytes.  The file is mapped into memory (or read, where
+I<mmap> is unavailable), so opening even a multi-gigabyte index is
+immediate, and the operating system shares its pages among all
+processes using it.  A lookup consults one table entry and then
+binary-searches a small contiguous run of digests.
+
+=head1 METHODS
+
+=over 4
+
+=item B<build($filename, \@digests)>
+
+=item B<build($filename, $listfile)>
+
+=item B<build($filename, *FILE)>
+
+Writes a new index to I<$filename>, and returns it opened as by
+I<new>.  The digests may be given as an array of binary or hexadecimal
+strings, or read from a file or filehandle, in which case the first
+hexadecimal digest on each line is used and lines without one are
+skipped.  All digests must have the same length, i.e. come from the
+same algorithm.  Duplicates are removed.  The routine croaks on
+malformed input or I/O errors.
+
+Building requires memory for one copy of the binary digests.
+
+=item B<new($filename)>
+
+Opens an existing index, returning undef if the file cannot be opened
+or is not a valid index (check I<$!> for the reason).
+
+=item B<contains($digest)>
+
+Returns true if I<$digest> is in the index, and false if not.  The
+digest may be in binary or hexadecimal form; binary lookups involve
+no decoding at all.  Returns undef if I<$digest> is of the wrong
+length for this index.
+
+=item B<count>
+
+Returns the number of distinct digests in the index.
+
+=item B<digestlen>
+
+Returns the length in bytes of the digests in the index (e.g. 20 for
+SHA-1, 32 for SHA-256).
+
+=back
+
+=head1 SEE ALSO
+
+L<Digest::SHA>, L<shasum>
+
+=head1 AUTHOR
+
+	Mark Shelor	<mshelor@cpan.org>
+
+=head1 COPYRIGHT AND LICENSE
+
+Copyright (C) 2003-2017 Mark Shelor
+
+This library is free software; you can redistribute it and/or modify
+it under the same terms as Perl itself.
+
+L<perlartistic>
+
+=cut
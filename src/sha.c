@@ -17,6 +17,7 @@
 #include <ctype.h>
 #include "sha.h"
 #include "sha64bit.h"
+#include "shaprobe.h"
 
 #define W32	SHA32			/* useful abbreviations */
 #define C32	SHA32_CONST
@@ -212,6 +213,37 @@ static void sha256(SHA *s, UCHR *block)		/* SHA-224/256 transform */
 	H[4] += e; H[5] += f; H[6] += g; H[7] += h;
 }
 
+/* sha256sched: expands block into the full 64-word message schedule */
+static void sha256sched(W32 *W, UCHR *block)
+{
+	int t;
+
+	SHA32_SCHED(W, block);
+	for (t = 16; t < 64; t++)
+		W[t] = LO32(sigma1(W[t-2]) + W[t-7] +
+			sigma0(W[t-15]) + W[t-16]);
+}
+
+/* sha256w: SHA-224/256 transform using a precomputed schedule W */
+static void sha256w(SHA *s, const W32 *W)
+{
+	int t;
+	W32 a, b, c, d, e, f, g, h, T1;
+	const W32 *kp = K256;
+	W32 *H = s->H32;
+
+	a = H[0]; b = H[1]; c = H[2]; d = H[3];
+	e = H[4]; f = H[5]; g = H[6]; h = H[7];
+
+	for (t = 0; t < 64; t += 8) {
+		M21(W[t  ]); M22(W[t+1]); M23(W[t+2]); M24(W[t+3]);
+		M25(W[t+4]); M26(W[t+5]); M27(W[t+6]); M28(W[t+7]);
+	}
+
+	H[0] += a; H[1] += b; H[2] += c; H[3] += d;
+	H[4] += e; H[5] += f; H[6] += g; H[7] += h;
+}
+
 #include "sha64bit.c"
 
 #define BITSET(s, pos)	s[(pos) >> 3] &  (UCHR)  (0x01 << (7 - (pos) % 8))
@@ -279,10 +311,99 @@ static UCHR *statecpy(SHA *s, UCHR *buf)
 	return(buf);
 }
 
+/* sha256s: SHA-224/256 transform that expands the whole schedule first */
+static void sha256s(SHA *s, UCHR *block)
+{
+	W32 W[64];
+
+	sha256sched(W, block);
+	sha256w(s, W);
+}
+
+typedef struct {
+	int alg;			/* family: SHA1, SHA256, or SHA512 */
+	const char *name;
+	void (*sha)(SHA *, UCHR *);
+} SHAKERNEL;
+
+	/* every compiled transform; the first of each family is the
+	 * default, and the selected ones are used by new objects */
+
+static const SHAKERNEL shakernels[] = {
+	{SHA1,   "c",     sha1},
+	{SHA256, "c",     sha256},
+	{SHA256, "sched", sha256s},
+	{SHA512, "c",     sha512},
+	{0,      NULL,    NULL}
+};
+
+static void (*sha1x)(SHA *, UCHR *) = sha1;
+static void (*sha256x)(SHA *, UCHR *) = sha256;
+static void (*sha512x)(SHA *, UCHR *) = sha512;
+
+/* shafamily: returns the transform family of alg, or 0 if unknown */
+static int shafamily(int alg)
+{
+	if (alg == SHA1)
+		return(SHA1);
+	if (alg == SHA224 || alg == SHA256)
+		return(SHA256);
+	if (alg == SHA384 || alg == SHA512 ||
+		alg == SHA512224 || alg == SHA512256)
+		return(sha_384_512 ? SHA512 : 0);
+	return(0);
+}
+
+/* shakernel: returns the i-th compiled kernel for alg, or NULL */
+static const SHAKERNEL *shakernel(int alg, int i)
+{
+	const SHAKERNEL *k;
+	int family = shafamily(alg);
+
+	for (k = shakernels; k->name != NULL; k++)
+		if (k->alg == family && i-- == 0)
+			return(k);
+	return(NULL);
+}
+
+/* shaselected: returns the kernel new objects of type alg will use */
+static const SHAKERNEL *shaselected(int alg)
+{
+	int i;
+	const SHAKERNEL *k;
+	void (*sha)(SHA *, UCHR *) = shafamily(alg) == SHA1 ? sha1x :
+		(shafamily(alg) == SHA256 ? sha256x : sha512x);
+
+	for (i = 0; (k = shakernel(alg, i)) != NULL; i++)
+		if (k->sha == sha)
+			return(k);
+	return(NULL);
+}
+
+/* shaselect: selects named kernel for alg's family; returns 0 if none */
+static int shaselect(int alg, const char *name)
+{
+	int i;
+	const SHAKERNEL *k;
+
+	for (i = 0; (k = shakernel(alg, i)) != NULL; i++)
+		if (strcmp(k->name, name) == 0)
+			break;
+	if (k == NULL)
+		return(0);
+	if (k->alg == SHA1)
+		sha1x = k->sha;
+	else if (k->alg == SHA256)
+		sha256x = k->sha;
+	else
+		sha512x = k->sha;
+	return(1);
+}
+
 #define SHA_INIT(s, algo, transform) 					\
 	do {								\
 		Zero(s, 1, SHA);					\
-		s->alg = algo; s->sha = sha ## transform;		\
+		s->alg = algo; s->sha = sha ## transform ## x;		\
 		if (s->alg <= SHA256)					\
 			Copy(H0 ## algo, s->H32, 8, SHA32);		\
 		else							\
@@ -382,12 +503,18 @@ static ULNG shawrite(UCHR *bitstr, ULNG bitcnt, SHA *s)
 		if (SHA_LO32(++s->lenlh) == 0)
 			if (SHA_LO32(++s->lenhl) == 0)
 				s->lenhh++;
-	if (s->blockcnt == 0)
+	if (s->blockcnt == 0) {
+		SHA_PROBE4(write, s, s->alg, bitcnt, SHA_PATH_DIRECT);
 		return(shadirect(bitstr, bitcnt, s));
-	else if (s->blockcnt % 8 == 0)
+	}
+	else if (s->blockcnt % 8 == 0) {
+		SHA_PROBE4(write, s, s->alg, bitcnt, SHA_PATH_BYTES);
 		return(shabytes(bitstr, bitcnt, s));
-	else
+	}
+	else {
+		SHA_PROBE4(write, s, s->alg, bitcnt, SHA_PATH_BITS);
 		return(shabits(bitstr, bitcnt, s));
+	}
 }
 
 /* shafinish: pads remaining block(s) and computes final digest state */
@@ -413,6 +540,7 @@ static void shafinish(SHA *s)
 	w32mem(s->block + lhpos, s->lenlh);
 	w32mem(s->block + llpos, s->lenll);
 	s->sha(s, s->block);
+	SHA_PROBE2(finish, s, s->alg);
 }
 
 #define shadigest(state)	digcpy(state)
@@ -486,6 +614,7 @@ static HMAC *hmacinit(HMAC *h, int alg, UCHR *key, UINT keylen)
 	UINT i;
 	SHA ksha;
 
+	SHA_PROBE2(hmac_init, alg, keylen);
 	Zero(h, 1, HMAC);
 	if (!shainit(&h->isha, alg))
 		return(NULL);
@@ -511,12 +640,6 @@ static HMAC *hmacinit(HMAC *h, int alg, UCHR *key, UINT keylen)
 	return(h);
 }
 
-/* hmacwrite: triggers a state update using data in bitstr/bitcnt */
-static ULNG hmacwrite(UCHR *bitstr, ULNG bitcnt, HMAC *h)
-{
-	return(shawrite(bitstr, bitcnt, &h->isha));
-}
-
 /* hmacfinish: computes final digest state */
 static void hmacfinish(HMAC *h)
 {
@@ -0,0 +1,294 @@
+/*
+ * shaafalg.c: optional Linux kernel crypto API (AF_ALG) backend
+ *
+ * The kernel may provide accelerated SHA implementations, and an AF_ALG
+ * hash socket can consume file data through splice(2) without copying
+ * it to userspace.  The socket only yields a final digest, however,
+ * never an intermediate state, so the backend is used only where a
+ * whole message is hashed from scratch in one call.  Every entry point
+ * returns -1 without consuming any input when the backend cannot be
+ * used, letting the caller fall back to the built-in transforms.
+ *
+ * Copyright (C) 2003-2017 Mark Shelor, All Rights Reserved
+ *
+ * Version: 5.98
+ * Wed Oct  4 00:40:02 MST 2017
+ *
+ */
+
+#define AFALG_MIN_SIZE		65536	/* smaller inputs stay in-process */
+#define AFALG_PIPE_SIZE		65536
+
+static int afalg_enabled = 1;
+
+#ifdef SHA_AFALG
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <linux/if_alg.h>
+
+#ifndef AF_ALG
+	#define AF_ALG		38
+#endif
+
+#ifndef SOCK_CLOEXEC
+	#define SOCK_CLOEXEC	0
+#endif
+
+static const int afalg_algs[] = {SHA1, SHA224, SHA256, SHA384, SHA512};
+static const char *afalg_names[] =
+	{"sha1", "sha224", "sha256", "sha384", "sha512"};
+
+	/* bound transform sockets, opened on first use: 0 = not yet
+	 * tried, -1 = unavailable, otherwise descriptor + 1; the device
+	 * and inode identify the socket, in case the program has since
+	 * closed the descriptor and its number been reused */
+
+static int afalg_tfm[] = {0, 0, 0, 0, 0};
+static dev_t afalg_dev[] = {0, 0, 0, 0, 0};
+static ino_t afalg_ino[] = {0, 0, 0, 0, 0};
+
+/* afalgslot: returns table index for alg, or -1 if kernel lacks it */
+static int afalgslot(int alg)
+{
+	int i;
+
+	for (i = 0; i < (int) (sizeof(afalg_algs)/sizeof(int)); i++)
+		if (afalg_algs[i] == alg)
+			return(i);
+	return(-1);
+}
+
+/* afalgopen: returns a fresh operation socket for alg, or -1 */
+static int afalgopen(int alg)
+{
+	int i, fd;
+	struct stat st;
+	struct sockaddr_alg sa;
+
+	if (!afalg_enabled || (i = afalgslot(alg)) < 0)
+		return(-1);
+
+		/* a cached descriptor that no longer refers to our socket
+		 * belongs to the program now: forget it, never close it */
+
+	if (afalg_tfm[i] > 0 && (fstat(afalg_tfm[i] - 1, &st) < 0 ||
+		st.st_dev != afalg_dev[i] || st.st_ino != afalg_ino[i]))
+		afalg_tfm[i] = 0;
+	if (afalg_tfm[i] == 0) {
+		afalg_tfm[i] = -1;
+		if ((fd = socket(AF_ALG, SOCK_SEQPACKET|SOCK_CLOEXEC, 0)) < 0)
+			return(-1);
+		Zero(&sa, 1, struct sockaddr_alg);
+		sa.salg_family = AF_ALG;
+		strcpy((char *) sa.salg_type, "hash");
+		strcpy((char *) sa.salg_name, afalg_names[i]);
+		if (bind(fd, (struct sockaddr *) &sa, sizeof(sa)) < 0 ||
+			fstat(fd, &st) < 0) {
+			close(fd);
+			return(-1);
+		}
+		afalg_dev[i] = st.st_dev;
+		afalg_ino[i] = st.st_ino;
+		afalg_tfm[i] = fd + 1;
+	}
+	if (afalg_tfm[i] < 0)
+		return(-1);
+	return(accept(afalg_tfm[i] - 1, NULL, 0));
+}
+
+/* afalgfinish: finalizes op and stores the kernel's digest in s */
+static int afalgfinish(int op, SHA *s)
+{
+	ssize_t n;
+	UCHR buf[SHA_MAX_DIGEST_BITS/8];
+
+	do n = send(op, NULL, 0, 0);
+	while (n < 0 && errno == EINTR);
+	if (n < 0)
+		return(-1);
+	do n = read(op, s->digest, s->digestlen);
+	while (n < 0 && errno == EINTR);
+	if (n != (ssize_t) s->digestlen)
+		return(-1);
+
+		/* load the digest into H, so that digcpy and the
+		 * encoders reproduce it (bytes past digestlen are 0) */
+
+	Zero(buf, sizeof(buf), UCHR);
+	Copy(s->digest, buf, s->digestlen, UCHR);
+	statecpy(s, buf);
+	return(0);
+}
+
+/* afalgsend: sends len bytes of data on op, flagged as more to come */
+static int afalgsend(int op, UCHR *data, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		if ((n = send(op, data, len, MSG_MORE)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return(-1);
+		}
+		data += n;
+		len -= (size_t) n;
+	}
+	return(0);
+}
+
+/* afalgfresh: returns 1 if no data has yet been added to s */
+static int afalgfresh(SHA *s)
+{
+	return(s->blockcnt == 0 && s->lenll == 0 && s->lenlh == 0 &&
+		s->lenhl == 0 && s->lenhh == 0);
+}
+
+/* afalgbegin: returns an operation socket for fresh state s, or -1 */
+static int afalgbegin(SHA *s)
+{
+	return(afalgfresh(s) ? afalgopen(s->alg) : -1);
+}
+
+/* afalgsplice: moves exactly len bytes from fd in to fd out */
+static int afalgsplice(int in, int out, size_t len, unsigned int flags)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		if ((n = splice(in, NULL, out, NULL, len, flags)) <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			return(-1);
+		}
+		len -= (size_t) n;
+	}
+	return(0);
+}
+
+/* afalgtee: duplicates exactly len bytes from pipe in into pipe out */
+static int afalgtee(int in, int out, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		if ((n = tee(in, out, len, 0)) <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			return(-1);
+		}
+		len -= (size_t) n;
+	}
+	return(0);
+}
+
+/* afalgdrain: moves exactly len bytes from pipe in to out, by splice
+ * where out allows it (e.g. not an O_APPEND file on older kernels) and
+ * by read/write otherwise */
+static int afalgdrain(int in, int out, size_t len, int *spliceout, UCHR *buf)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		if (*spliceout) {
+			n = splice(in, NULL, out, NULL, len, SPLICE_F_MOVE);
+			if (n < 0 && errno == EINVAL) {
+				*spliceout = 0;
+				continue;
+			}
+		}
+		else if ((n = read(in, buf, len < AFALG_PIPE_SIZE ?
+				len : AFALG_PIPE_SIZE)) > 0 &&
+				fdwrite(out, buf, (size_t) n) != 0)
+			return(-1);
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+			return(-1);
+		}
+		len -= (size_t) n;
+	}
+	return(0);
+}
+
+#endif	/* SHA_AFALG */
+
+/* afalgusable: returns 1 if the backend is enabled and serves alg */
+static int afalgusable(int alg)
+{
+#ifdef SHA_AFALG
+	int op;
+
+	if ((op = afalgopen(alg)) < 0)
+		return(0);
+	close(op);
+	return(1);
+#else
+	(void) alg;
+	return(0);
+#endif
+}
+
+#ifdef SHA_POSIX_IO
+
+/* afalgcopy: copies in to out with zero-copy splice/tee, hashing in the
+ * kernel; returns 0 or errno, or -1 if nothing was done because the
+ * backend or splicing is unavailable */
+static int afalgcopy(SHA *s, int in, int out, double *ncopied)
+{
+#ifdef SHA_AFALG
+	int op, err = 0, first = 1, spliceout = 1;
+	int data[2], copy[2];
+	ssize_t n;
+	UCHR buf[AFALG_PIPE_SIZE];
+
+	*ncopied = 0.0;
+	if ((op = afalgbegin(s)) < 0)
+		return(-1);
+	if (pipe(data) < 0) {
+		close(op);
+		return(-1);
+	}
+	if (pipe(copy) < 0) {
+		close(data[0]), close(data[1]), close(op);
+		return(-1);
+	}
+	for (;;) {
+		n = splice(in, NULL, data[1], NULL, AFALG_PIPE_SIZE,
+			SPLICE_F_MOVE|SPLICE_F_MORE);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && first) {
+			err = -1;		/* input can't be spliced */
+			break;
+		}
+		if (n <= 0) {
+			err = n < 0 ? errno : 0;
+			break;
+		}
+		first = 0;
+		if (afalgtee(data[0], copy[1], (size_t) n) < 0 ||
+			afalgsplice(copy[0], op, (size_t) n,
+				SPLICE_F_MOVE|SPLICE_F_MORE) < 0 ||
+			afalgdrain(data[0], out, (size_t) n,
+				&spliceout, buf) < 0) {
+			err = errno ? errno : EIO;
+			break;
+		}
+		*ncopied += (double) n;
+	}
+	close(data[0]), close(data[1]);
+	close(copy[0]), close(copy[1]);
+	if (err == 0 && afalgfinish(op, s) < 0)
+		err = errno ? errno : EIO;
+	close(op);
+	return(err);
+#else
+	(void) s, (void) in, (void) out;
+	*ncopied = 0.0;
+	return(-1);
+#endif
+}
+
+#endif	/* SHA_POSIX_IO */
@@ -0,0 +1,319 @@
+/*
+ * shaindex.c: sorted, memory-mapped index of known SHA digests
+ *
+ * Index file layout (all integers big-endian):
+ *
+ *	offset	size		contents
+ *	0	8		magic "DSHAIDX1"
+ *	8	4		digest length in bytes (dlen)
+ *	12	4		reserved (0)
+ *	16	8		number of digests (count)
+ *	24	65537 * 8	bucket table: start of the digests whose
+ *				first two bytes equal i, for i = 0..65536
+ *	526320	count * dlen	digests, sorted in ascending order
+ *
+ * A lookup reads one bucket table entry and binary-searches a bucket
+ * of about count/65536 digests, all of them adjacent in the file.
+ *
+ * Copyright (C) 2003-2017 Mark Shelor, All Rights Reserved
+ *
+ * Version: 5.98
+ * Wed Oct  4 00:40:02 MST 2017
+ *
+ */
+
+#ifdef SHA_POSIX_IO
+	#include <sys/stat.h>
+	#ifdef HAS_MMAP
+		#include <sys/mman.h>
+		#define IDX_MMAP
+	#endif
+#endif
+
+#define IDX_MAGIC	"DSHAIDX1"
+#define IDX_BUCKETS	65536
+#define IDX_HDRLEN	24
+#define IDX_TABLEN	((IDX_BUCKETS + 1) * 8)
+#define IDX_DATAPOS	(IDX_HDRLEN + IDX_TABLEN)
+
+#define IDX_BUCKET(d)	(((UINT) (d)[0] << 8) | (d)[1])
+
+typedef struct {
+	UCHR *base;		/* mapped (or loaded) file image */
+	size_t len;
+	int mapped;
+	UINT dlen;
+	double count;
+	UCHR *table;
+	UCHR *data;
+} SHAINDEX;
+
+/* memw64: returns 64-bit big-endian count (as double) from memory */
+static double memw64(UCHR *mem)
+{
+	return((double) memw32(mem) * 4294967296.0 + (double) memw32(mem+4));
+}
+
+/* idxpos: returns the bucket table entry for bucket i */
+static size_t idxpos(SHAINDEX *x, UINT i)
+{
+	return((size_t) memw64(x->table + 8 * i));
+}
+
+#ifdef SHA_POSIX_IO
+
+/* idxload: maps (or reads) the file at path into x; returns 0, or -1
+ * with errno set */
+static int idxload(pTHX_ SHAINDEX *x, const char *path)
+{
+	int fd, err;
+	ssize_t n;
+	size_t pos;
+	struct stat st;
+
+	if ((fd = open(path, O_RDONLY)) < 0)
+		return(-1);
+	if (fstat(fd, &st) < 0)
+		goto fail;
+	errno = EINVAL;
+	if ((double) st.st_size < (double) IDX_DATAPOS ||
+		(double) st.st_size > (double) (size_t) -1)
+		goto fail;
+	x->len = (size_t) st.st_size;
+#ifdef IDX_MMAP
+	x->base = (UCHR *) mmap(NULL, x->len, PROT_READ, MAP_SHARED, fd, 0);
+	if (x->base == (UCHR *) MAP_FAILED)
+		x->base = NULL;
+	else
+		x->mapped = 1;
+#endif
+	if (x->base == NULL) {
+		Newx(x->base, x->len, UCHR);
+		for (pos = 0; pos < x->len; pos += (size_t) n)
+			if ((n = fdread(fd, x->base + pos, x->len - pos)) <= 0)
+				goto fail;
+	}
+	close(fd);
+	return(0);
+
+fail:
+	err = errno;
+	close(fd);
+	errno = err;
+	return(-1);
+}
+
+#else
+
+/* idxload: reads the file at path into x through PerlIO; returns 0,
+ * or -1 with errno set */
+static int idxload(pTHX_ SHAINDEX *x, const char *path)
+{
+	int err;
+	SSize_t n;
+	Off_t size;
+	size_t pos;
+	PerlIO *f;
+
+	if ((f = PerlIO_open(path, "rb")) == NULL)
+		return(-1);
+	if (PerlIO_seek(f, 0, SEEK_END) < 0 || (size = PerlIO_tell(f)) < 0 ||
+		PerlIO_seek(f, 0, SEEK_SET) < 0)
+		goto fail;
+	errno = EINVAL;
+	if ((double) size < (double) IDX_DATAPOS ||
+		(double) size > (double) (size_t) -1)
+		goto fail;
+	x->len = (size_t) size;
+	Newx(x->base, x->len, UCHR);
+	for (pos = 0; pos < x->len; pos += (size_t) n)
+		if ((n = PerlIO_read(f, x->base + pos, x->len - pos)) <= 0)
+			goto fail;
+	PerlIO_close(f);
+	return(0);
+
+fail:
+	err = errno;
+	PerlIO_close(f);
+	errno = err;
+	return(-1);
+}
+
+#endif
+
+/* idxopen: maps index file; returns NULL (with errno set) on failure */
+static SHAINDEX *idxopen(pTHX_ const char *path)
+{
+	UINT i;
+	size_t prev, pos;
+	SHAINDEX *x;
+
+	Newxz(x, 1, SHAINDEX);
+	if (idxload(aTHX_ x, path) < 0)
+		goto fail;
+
+	errno = EINVAL;
+	if (memcmp(x->base, IDX_MAGIC, 8) != 0)
+		goto fail;
+	x->dlen = memw32(x->base + 8);
+	x->count = memw64(x->base + 16);
+	x->table = x->base + IDX_HDRLEN;
+	x->data = x->base + IDX_DATAPOS;
+	if (x->dlen < 2 || x->dlen > SHA_MAX_DIGEST_BITS/8)
+		goto fail;
+	if ((double) x->len != IDX_DATAPOS + x->count * x->dlen)
+		goto fail;
+	for (i = 0, prev = 0; i <= IDX_BUCKETS; prev = pos, i++)
+		if ((pos = idxpos(x, i)) < prev || (double) pos > x->count)
+			goto fail;
+	if ((double) prev != x->count)
+		goto fail;
+	return(x);
+
+fail:
+	i = (UINT) errno;
+	if (x->base != NULL) {
+#ifdef IDX_MMAP
+		if (x->mapped)
+			munmap((void *) x->base, x->len);
+		else
+#endif
+			Safefree(x->base);
+	}
+	Safefree(x);
+	errno = (int) i;
+	return(NULL);
+}
+
+/* idxclose: releases the index */
+static void idxclose(SHAINDEX *x)
+{
+#ifdef IDX_MMAP
+	if (x->mapped)
+		munmap((void *) x->base, x->len);
+	else
+#endif
+		Safefree(x->base);
+	Safefree(x);
+}
+
+/* idxcontains: returns 1 if the raw digest d is present in the index */
+static int idxcontains(SHAINDEX *x, UCHR *d)
+{
+	int c;
+	size_t lo, hi, mid;
+	UINT b = IDX_BUCKET(d);
+
+	lo = idxpos(x, b);
+	hi = idxpos(x, b + 1);
+	while (lo < hi) {
+		mid = lo + ((hi - lo) >> 1);
+		if ((c = memcmp(x->data + mid * x->dlen, d, x->dlen)) == 0)
+			return(1);
+		if (c < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return(0);
+}
+
+/* idxhex: decodes 2*dlen hex digits into raw; returns 0 if malformed */
+static int idxhex(UCHR *hex, UINT dlen, UCHR *raw)
+{
+	UINT i;
+	const char *hi, *lo;
+
+	for (i = 0; i < dlen; i++, hex += 2) {
+		if (!hex[0] || !hex[1] ||
+			(hi = strchr(xmap, tolower(hex[0]))) == NULL ||
+			(lo = strchr(xmap, tolower(hex[1]))) == NULL)
+			return(0);
+		raw[i] = (UCHR) (((hi - xmap) << 4) | (lo - xmap));
+	}
+	return(1);
+}
+
+/* idxsift: heapsort helper; restores heap property below node i */
+static void idxsift(UCHR *v, size_t i, size_t n, UINT dlen, UCHR *tmp)
+{
+	size_t child;
+
+	while ((child = 2 * i + 1) < n) {
+		if (child + 1 < n &&
+			memcmp(v + child * dlen, v + (child+1) * dlen, dlen) < 0)
+			child++;
+		if (memcmp(v + i * dlen, v + child * dlen, dlen) >= 0)
+			return;
+		Copy(v + i * dlen, tmp, dlen, UCHR);
+		Copy(v + child * dlen, v + i * dlen, dlen, UCHR);
+		Copy(tmp, v + child * dlen, dlen, UCHR);
+		i = child;
+	}
+}
+
+/* idxheapsort: sorts n records of dlen bytes in place */
+static void idxheapsort(UCHR *v, size_t n, UINT dlen)
+{
+	size_t i;
+	UCHR tmp[SHA_MAX_DIGEST_BITS/8];
+
+	if (n < 2)
+		return;
+	for (i = n / 2; i-- > 0; )
+		idxsift(v, i, n, dlen, tmp);
+	for (i = n - 1; i > 0; i--) {
+		Copy(v, tmp, dlen, UCHR);
+		Copy(v + i * dlen, v, dlen, UCHR);
+		Copy(tmp, v + i * dlen, dlen, UCHR);
+		idxsift(v, 0, i, dlen, tmp);
+	}
+}
+
+/* idxsort: sorts and de-duplicates n records of dlen bytes in place,
+ * filling table (IDX_BUCKETS + 1 entries) with the bucket offsets;
+ * returns the new record count */
+static size_t idxsort(UCHR *v, size_t n, UINT dlen, size_t *table)
+{
+	size_t i, j, b, *next;
+	UCHR rec[SHA_MAX_DIGEST_BITS/8], tmp[SHA_MAX_DIGEST_BITS/8];
+
+		/* distribute records to their buckets in place
+		 * (American flag sort on the first two bytes) */
+
+	Zero(table, IDX_BUCKETS + 1, size_t);
+	for (i = 0; i < n; i++)
+		table[IDX_BUCKET(v + i * dlen) + 1]++;
+	for (b = 0; b < IDX_BUCKETS; b++)
+		table[b + 1] += table[b];
+	Newx(next, IDX_BUCKETS, size_t);
+	Copy(table, next, IDX_BUCKETS, size_t);
+	for (b = 0; b < IDX_BUCKETS; b++)
+		while (next[b] < table[b + 1]) {
+			Copy(v + next[b] * dlen, rec, dlen, UCHR);
+			while ((j = IDX_BUCKET(rec)) != b) {
+				Copy(v + next[j] * dlen, tmp, dlen, UCHR);
+				Copy(rec, v + next[j]++ * dlen, dlen, UCHR);
+				Copy(tmp, rec, dlen, UCHR);
+			}
+			Copy(rec, v + next[b]++ * dlen, dlen, UCHR);
+		}
+	Safefree(next);
+
+		/* sort each bucket, then squeeze out duplicates */
+
+	for (b = 0; b < IDX_BUCKETS; b++)
+		idxheapsort(v + table[b] * dlen, table[b + 1] - table[b], dlen);
+	for (i = j = 0, b = 0; i < n; i++) {
+		while (b <= IDX_BUCKET(v + i * dlen))
+			table[b++] = j;
+		if (j > 0 && memcmp(v + (j-1) * dlen, v + i * dlen, dlen) == 0)
+			continue;
+		if (i != j)
+			Copy(v + i * dlen, v + j * dlen, dlen, UCHR);
+		j++;
+	}
+	while (b <= IDX_BUCKETS)
+		table[b++] = j;
+	return(j);
+}
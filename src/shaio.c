@@ -0,0 +1,266 @@
+/*
+ * shaio.c: descriptor-level I/O routines for SHA digest objects
+ *
+ * These routines operate on raw file descriptors and never call back
+ * into the Perl interpreter, so they may safely run on a worker thread.
+ * They need POSIX descriptor I/O (SHA_POSIX_IO, set by Makefile.PL);
+ * without it, the module reads through PerlIO instead.
+ *
+ * Copyright (C) 2003-2017 Mark Shelor, All Rights Reserved
+ *
+ * Version: 5.98
+ * Wed Oct  4 00:40:02 MST 2017
+ *
+ */
+
+#ifdef SHA_POSIX_IO
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef SHA_THREADS
+	#include <pthread.h>
+#endif
+
+#define SHA_FD_BUFFER_SIZE	65536
+
+/* fdread: read(2) wrapper that restarts after signal interruption */
+static ssize_t fdread(int fd, UCHR *buf, size_t len)
+{
+	ssize_t n;
+
+	do n = read(fd, buf, len);
+	while (n < 0 && errno == EINTR);
+	return(n);
+}
+
+/* shafdadd: reads fd until EOF, updating state; returns 0 or errno */
+static int shafdadd(SHA *s, int fd)
+{
+	ssize_t n;
+	UCHR in[SHA_FD_BUFFER_SIZE];
+
+	while ((n = fdread(fd, in, sizeof(in))) > 0)
+		shawrite(in, (ULNG) n << 3, s);
+	return(n < 0 ? errno : 0);
+}
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+
+static UCHR fdzeros[SHA_FD_BUFFER_SIZE];	/* stands in for holes */
+
+/* shazeros: updates state with len zero bytes, without any I/O */
+static void shazeros(SHA *s, off_t len)
+{
+	size_t k;
+
+	for (; len > 0; len -= (off_t) k) {
+		k = len < (off_t) sizeof(fdzeros) ?
+			(size_t) len : sizeof(fdzeros);
+		shawrite(fdzeros, (ULNG) k << 3, s);
+	}
+}
+
+#endif
+
+/* shafdsparse: like shafdadd, but hashes the holes of a sparse regular
+ * file as zeros instead of reading them; returns 0 or errno, or -1 if
+ * nothing was done because fd has no holes or they can't be located */
+static int shafdsparse(SHA *s, int fd, double *nbytes)
+{
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+	struct stat st;
+	off_t pos, end, data, hole;
+	ssize_t n;
+	size_t k;
+	UCHR in[SHA_FD_BUFFER_SIZE];
+
+	*nbytes = 0.0;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) ||
+		(double) st.st_blocks * 512.0 >= (double) st.st_size)
+		return(-1);
+	if ((pos = lseek(fd, 0, SEEK_CUR)) < 0)
+		return(-1);
+	if ((data = lseek(fd, pos, SEEK_DATA)) < 0 && errno != ENXIO)
+		return(-1);
+	for (end = st.st_size; pos < end; ) {
+		if (data < 0 || data > end)	/* ENXIO: trailing hole */
+			data = end;
+		shazeros(s, data - pos);
+		*nbytes += (double) (data - pos);
+		if ((pos = data) >= end)
+			break;
+		if ((hole = lseek(fd, pos, SEEK_HOLE)) < 0 || hole > end)
+			hole = end;
+		if (lseek(fd, pos, SEEK_SET) < 0)
+			return(errno);
+		while (pos < hole) {
+			k = hole - pos < (off_t) sizeof(in) ?
+				(size_t) (hole - pos) : sizeof(in);
+			if ((n = fdread(fd, in, k)) <= 0)
+				return(n < 0 ? errno : 0);	/* shrunk */
+			shawrite(in, (ULNG) n << 3, s);
+			*nbytes += (double) n;
+			pos += (off_t) n;
+		}
+		if (pos < end && (data = lseek(fd, pos, SEEK_DATA)) < 0 &&
+			errno != ENXIO)
+			data = pos;
+	}
+	return(lseek(fd, end, SEEK_SET) < 0 ? errno : 0);
+#else
+	(void) s, (void) fd;
+	*nbytes = 0.0;
+	return(-1);
+#endif
+}
+
+/* fdwrite: writes all of buf to fd; returns 0 or errno */
+static int fdwrite(int fd, UCHR *buf, size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		if ((n = write(fd, buf, len)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return(errno);
+		}
+		buf += n;
+		len -= (size_t) n;
+	}
+	return(0);
+}
+
+/* shafdcopy: copies in to out until EOF, hashing the data in the same
+ * pass through a single buffer; returns 0 or errno */
+static int shafdcopy(SHA *s, int in, int out, double *ncopied)
+{
+	ssize_t n;
+	int err;
+	UCHR buf[SHA_FD_BUFFER_SIZE];
+
+	*ncopied = 0.0;
+	while ((n = fdread(in, buf, sizeof(buf))) > 0) {
+		shawrite(buf, (ULNG) n << 3, s);
+		if ((err = fdwrite(out, buf, (size_t) n)) != 0)
+			return(err);
+		*ncopied += (double) n;
+	}
+	return(n < 0 ? errno : 0);
+}
+
+typedef struct {
+	SHA sha;		/* private copy of state, owned by worker */
+	SHA *target;		/* object receiving state on completion */
+	void *owner;		/* XS bookkeeping: keeps target alive */
+	int fd;			/* input descriptor, closed once joined */
+	int ready[2];		/* readiness pipe: worker writes one byte */
+	int err;		/* errno from worker, 0 on success */
+	int joined;
+	pid_t pid;		/* process that started the job */
+#ifdef SHA_THREADS
+	pthread_t tid;
+#endif
+} SHAJOB;
+
+/* shajobrun: hashes the job's input and signals readiness */
+static void *shajobrun(void *arg)
+{
+	SHAJOB *job = (SHAJOB *) arg;
+	ssize_t n;
+	double nbytes;
+
+	if ((job->err = shafdsparse(&job->sha, job->fd, &nbytes)) < 0)
+		job->err = shafdadd(&job->sha, job->fd);
+	do n = write(job->ready[1], "", 1);
+	while (n < 0 && errno == EINTR);
+	return(NULL);
+}
+
+/* shajobstart: begins hashing a dup of fd from the current state of s */
+static SHAJOB *shajobstart(SHA *s, int fd)
+{
+	SHAJOB *job;
+#ifdef SHA_THREADS
+	sigset_t all, old;
+#endif
+
+	Newxz(job, 1, SHAJOB);
+	if ((job->fd = dup(fd)) < 0) {
+		Safefree(job);
+		return(NULL);
+	}
+	if (pipe(job->ready) < 0) {
+		close(job->fd);
+		Safefree(job);
+		return(NULL);
+	}
+	Copy(s, &job->sha, 1, SHA);
+	job->target = s;
+	job->pid = getpid();
+#ifdef SHA_THREADS
+		/* signals belong to the interpreter thread only; if no
+		 * thread can be created, hash the input synchronously */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	if (pthread_create(&job->tid, NULL, shajobrun, job) != 0)
+		shajobrun(job), job->joined = 1;
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+#else
+	shajobrun(job), job->joined = 1;
+#endif
+	return(job);
+}
+
+/* shajobdone: returns 1 if the worker has finished, without blocking;
+ * in a child forked while the job ran, there is no worker to wait for */
+static int shajobdone(SHAJOB *job)
+{
+	struct pollfd p;
+
+	if (job->joined || job->pid != getpid())
+		return(1);
+	p.fd = job->ready[0], p.events = POLLIN, p.revents = 0;
+	return(poll(&p, 1, 0) > 0);
+}
+
+/* shajobwait: waits for the worker and copies its state into target;
+ * returns the worker's errno, or -1 in any process other than the one
+ * that started the job, where the worker thread doesn't exist */
+static int shajobwait(SHAJOB *job)
+{
+	if (job->pid != getpid()) {
+		job->target = NULL;
+		return(-1);
+	}
+	if (!job->joined) {
+#ifdef SHA_THREADS
+		pthread_join(job->tid, NULL);
+#endif
+		job->joined = 1;
+	}
+	if (job->fd >= 0)
+		close(job->fd), job->fd = -1;
+	if (job->target != NULL && !job->err)
+		Copy(&job->sha, job->target, 1, SHA);
+	job->target = NULL;
+	return(job->err);
+}
+
+/* shajobfree: releases the job and the descriptors this process holds
+ * for it (caller must have waited first) */
+static void shajobfree(SHAJOB *job)
+{
+	if (job->fd >= 0)
+		close(job->fd);
+	close(job->ready[0]);
+	close(job->ready[1]);
+	Safefree(job);
+}
+
+#endif	/* SHA_POSIX_IO */
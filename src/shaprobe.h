@@ -0,0 +1,39 @@
+/*
+ * shaprobe.h: static tracepoints (USDT) for SHA hashing entry points
+ *
+ * When built with SHA_USDT, each probe compiles to a single nop that
+ * tracers such as bpftrace, perf, or SystemTap can attach to at run
+ * time; otherwise the probes vanish entirely.  All probes belong to
+ * the "digest_sha" provider.
+ *
+ * Copyright (C) 2003-2017 Mark Shelor, All Rights Reserved
+ *
+ * Version: 5.98
+ * Wed Oct  4 00:40:02 MST 2017
+ *
+ */
+
+#ifndef _INCLUDE_SHAPROBE_H_
+#define _INCLUDE_SHAPROBE_H_
+
+#ifdef SHA_USDT
+	#include <sys/sdt.h>
+	#define SHA_PROBE2(name, a, b)	\
+		DTRACE_PROBE2(digest_sha, name, a, b)
+	#define SHA_PROBE3(name, a, b, c)	\
+		DTRACE_PROBE3(digest_sha, name, a, b, c)
+	#define SHA_PROBE4(name, a, b, c, d)	\
+		DTRACE_PROBE4(digest_sha, name, a, b, c, d)
+#else
+	#define SHA_PROBE2(name, a, b)
+	#define SHA_PROBE3(name, a, b, c)
+	#define SHA_PROBE4(name, a, b, c, d)
+#endif
+
+	/* shawrite data paths, reported by the "write" probe */
+
+#define SHA_PATH_DIRECT		0	/* block-aligned, hashed in place */
+#define SHA_PATH_BYTES		1	/* byte-aligned, via s->block */
+#define SHA_PATH_BITS		2	/* bit-aligned, one bit at a time */
+
+#endif	/* _INCLUDE_SHAPROBE_H_ */
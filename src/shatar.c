@@ -0,0 +1,280 @@
+/*
+ * shatar.c: routines to digest the members of a tar stream in one pass
+ *
+ * Understands POSIX ustar and pax archives, and the GNU long-name and
+ * base-256 size extensions.  The parser is fed the archive in pieces
+ * of any size; member data is hashed as it streams past, so nothing
+ * is buffered except the 512-byte headers and long-name/pax records.
+ *
+ * Copyright (C) 2003-2017 Mark Shelor, All Rights Reserved
+ *
+ * Version: 5.98
+ * Wed Oct  4 00:40:02 MST 2017
+ *
+ */
+
+#define TAR_BLOCK	512
+#define TAR_META_MAX	1048576		/* longer records are ignored */
+
+#define TAR_HEADER	0		/* parser states */
+#define TAR_DATA	1
+#define TAR_META	2
+#define TAR_SKIP	3
+#define TAR_END		4
+
+typedef struct {
+	SHA base;			/* fresh state for member digests */
+	SHA member;
+	int state;
+	int ready;			/* member digest complete */
+	int err;
+	UCHR hdr[TAR_BLOCK];
+	UINT hdrlen;
+	double left;			/* bytes left in current state */
+	double pad;			/* block padding after data/meta */
+	int metatype;			/* 'L' or 'x' */
+	char *meta;
+	size_t metalen;
+	char *name;			/* member name, NUL-terminated */
+	int havename;			/* set by a preceding L/x record */
+	double paxsize;
+	int havesize;
+} SHATAR;
+
+/* tarinit: returns a parser for members hashed with alg, or NULL */
+static SHATAR *tarinit(int alg)
+{
+	SHATAR *t;
+
+	Newxz(t, 1, SHATAR);
+	if (!shainit(&t->base, alg)) {
+		Safefree(t);
+		return(NULL);
+	}
+	Newx(t->meta, TAR_META_MAX, char);
+	Newxz(t->name, 1, char);
+	return(t);
+}
+
+/* tarfree: releases the parser */
+static void tarfree(SHATAR *t)
+{
+	Safefree(t->meta);
+	Safefree(t->name);
+	Safefree(t);
+}
+
+/* tarname: sets member name to pfx/p, each field ending at len or NUL */
+static void tarname(SHATAR *t, const char *pfx, size_t pfxlen,
+	const char *p, size_t len)
+{
+	size_t i, j;
+
+	for (i = 0; i < pfxlen && pfx[i]; i++)
+		;
+	for (j = 0; j < len && p[j]; j++)
+		;
+	Renew(t->name, i + j + 2, char);
+	if (i > 0) {
+		Copy(pfx, t->name, i, char);
+		t->name[i++] = '/';
+	}
+	Copy(p, t->name + i, j, char);
+	t->name[i + j] = '\0';
+}
+
+/* tarnum: returns value of an octal or base-256 numeric header field */
+static double tarnum(UCHR *p, UINT len)
+{
+	double v = 0.0;
+
+	if (*p & 0x80) {
+		if (*p & 0x40)			/* negative: never valid here */
+			return(-1.0);
+		v = (double) (*p++ & 0x3f);
+		while (--len)
+			v = v * 256.0 + (double) *p++;
+		return(v);
+	}
+	for (; len && (*p == ' ' || *p == '\0'); p++, len--)
+		;
+	for (; len && *p >= '0' && *p <= '7'; p++, len--)
+		v = v * 8.0 + (double) (*p - '0');
+	return(v);
+}
+
+/* tarsumok: returns 1 if header checksum is valid (signed or unsigned) */
+static int tarsumok(UCHR *h)
+{
+	UINT i;
+	long u = 0, s = 0;
+	double want = tarnum(h + 148, 8);
+
+	for (i = 0; i < TAR_BLOCK; i++) {
+		if (i >= 148 && i < 156) {
+			u += ' ', s += ' ';
+			continue;
+		}
+		u += h[i];
+		s += (signed char) h[i];
+	}
+	return(want == (double) u || want == (double) s);
+}
+
+/* tarpax: applies the path and size records of a pax extended header,
+ * each of the form "LEN KEY=VALUE\n" with LEN counting the whole record */
+static void tarpax(SHATAR *t)
+{
+	char *rec = t->meta, *end = t->meta + t->metalen;
+	char *p, *key, *val, *eol;
+	size_t len;
+
+	for (; rec < end; rec = eol + 1) {
+		for (p = rec, len = 0; p < end && *p >= '0' && *p <= '9'; p++)
+			len = len * 10 + (size_t) (*p - '0');
+		if (p >= end || *p != ' ' || len <= (size_t) (p - rec) ||
+			len > (size_t) (end - rec) || rec[len-1] != '\n')
+			return;
+		key = p + 1;
+		eol = rec + len - 1;
+		for (val = key; val < eol && *val != '='; val++)
+			;
+		if (val++ == eol || val - key != 5)
+			continue;
+		if (memcmp(key, "path", 4) == 0) {
+			tarname(t, NULL, 0, val, (size_t) (eol - val));
+			t->havename = 1;
+		}
+		else if (memcmp(key, "size", 4) == 0) {
+			for (t->paxsize = 0.0; val < eol &&
+				*val >= '0' && *val <= '9'; val++)
+				t->paxsize = t->paxsize * 10.0 +
+					(double) (*val - '0');
+			t->havesize = 1;
+		}
+	}
+}
+
+/* tarnext: advances past states whose byte count has run out */
+static void tarnext(SHATAR *t)
+{
+	while (t->left == 0.0 && t->state != TAR_HEADER &&
+			t->state != TAR_END) {
+		if (t->state == TAR_DATA)
+			t->ready = 1;
+		else if (t->state == TAR_META && t->metalen < TAR_META_MAX) {
+			if (t->metatype == 'L') {
+				tarname(t, NULL, 0, t->meta, t->metalen);
+				t->havename = 1;
+			}
+			else
+				tarpax(t);
+		}
+		if (t->state == TAR_SKIP)
+			t->state = TAR_HEADER;
+		else {
+			t->state = TAR_SKIP;
+			t->left = t->pad;
+		}
+	}
+}
+
+/* tarheader: interprets the header block just collected */
+static void tarheader(SHATAR *t)
+{
+	UINT i;
+	UCHR *h = t->hdr;
+	int type = h[156];
+	double size;
+
+	for (i = 0; i < TAR_BLOCK && h[i] == 0; i++)
+		;
+	if (i == TAR_BLOCK) {
+		t->state = TAR_END;
+		return;
+	}
+	if (!tarsumok(h) || (size = tarnum(h + 124, 12)) < 0.0) {
+		t->err = 1;
+		return;
+	}
+	if (type == 'L' || type == 'x') {
+		t->state = TAR_META;
+		t->metatype = type;
+		t->metalen = 0;
+	}
+	else {
+		if (t->havesize)
+			size = t->paxsize;
+		if (!t->havename) {
+			if (memcmp(h + 257, "ustar", 6) == 0)
+				tarname(t, (char *) h + 345, 155,
+					(char *) h, 100);
+			else
+				tarname(t, NULL, 0, (char *) h, 100);
+		}
+		t->havename = t->havesize = 0;
+
+			/* only regular files have their data hashed */
+
+		if (type == '0' || type == '\0' || type == '7') {
+			Copy(&t->base, &t->member, 1, SHA);
+			t->state = TAR_DATA;
+		}
+		else
+			t->state = TAR_SKIP;
+	}
+	t->left = size;
+	t->pad = fmod(TAR_BLOCK - fmod(size, TAR_BLOCK), TAR_BLOCK);
+	if (t->state == TAR_SKIP) {
+		t->left += t->pad;
+		t->pad = 0.0;
+	}
+	tarnext(t);
+}
+
+/* tarwrite: feeds up to n bytes of the archive to the parser, stopping
+ * early when a member's digest is complete (t->ready); returns the
+ * number of bytes consumed */
+static size_t tarwrite(SHATAR *t, UCHR *buf, size_t n)
+{
+	size_t k, used = 0;
+
+	while (used < n && !t->ready && !t->err) {
+		k = n - used;
+		if (t->state == TAR_END)
+			return(n);
+		if (t->state == TAR_HEADER) {
+			if (k > TAR_BLOCK - t->hdrlen)
+				k = TAR_BLOCK - t->hdrlen;
+			Copy(buf + used, t->hdr + t->hdrlen, k, UCHR);
+			used += k;
+			if ((t->hdrlen += (UINT) k) == TAR_BLOCK) {
+				t->hdrlen = 0;
+				tarheader(t);
+			}
+			continue;
+		}
+		if ((double) k > t->left)
+			k = (size_t) t->left;
+		if (t->state == TAR_DATA)
+			shawrite(buf + used, (ULNG) k << 3, &t->member);
+		else if (t->state == TAR_META) {
+			if (t->metalen + k < TAR_META_MAX)
+				Copy(buf + used, t->meta + t->metalen, k, char);
+			t->metalen += k;
+			if (t->metalen > TAR_META_MAX)
+				t->metalen = TAR_META_MAX;
+		}
+		used += k;
+		t->left -= (double) k;
+		tarnext(t);
+	}
+	return(t->err ? n : used);
+}
+
+/* tardone: returns 1 if the archive ended cleanly (at a header) */
+static int tardone(SHATAR *t)
+{
+	return(!t->err && t->hdrlen == 0 &&
+		(t->state == TAR_HEADER || t->state == TAR_END));
+}
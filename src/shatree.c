@@ -0,0 +1,107 @@
+/*
+ * shatree.c: routines to compute SHA Merkle tree roots and proof paths
+ *
+ * Copyright (C) 2003-2017 Mark Shelor, All Rights Reserved
+ *
+ * Version: 5.98
+ * Wed Oct  4 00:40:02 MST 2017
+ *
+ */
+
+#define SHA_TREE_MAX_DEPTH	64
+
+	/* the padding block's schedule serves whichever SHA-224/256
+	 * kernel is selected, since sha256w needs only the state */
+
+#define TREE_SCHED(s)	((s)->alg == SHA224 || (s)->alg == SHA256)
+
+typedef struct {
+	SHA base;			/* freshly initialized state */
+	UCHR *pfx;			/* node prefix */
+	UINT pfxlen;
+	int oneblock;			/* prefix||left||right fills a block */
+	UCHR pad[SHA_MAX_BLOCK_BITS/8];	/* padding block for that case */
+	W32 padW[64];			/* its SHA-224/256 schedule */
+	UCHR block[SHA_MAX_BLOCK_BITS/8];
+} SHATREE;
+
+/* treeinit: prepares node-hashing context for the algorithm in base */
+static void treeinit(SHATREE *t, UCHR *pfx, UINT pfxlen)
+{
+	UINT nbytes = t->base.blocksize >> 3;
+	UCHR *len = t->pad + nbytes - 4;
+
+	t->pfx = pfx;
+	t->pfxlen = pfxlen;
+	t->oneblock = pfxlen + 2 * t->base.digestlen == nbytes;
+	if (!t->oneblock)
+		return;
+
+		/* a message of exactly one block is followed by a
+		 * constant block: 1-bit, zeros, then the bit length */
+
+	Zero(t->pad, sizeof(t->pad), UCHR);
+	t->pad[0] = 0x80;
+	w32mem(len, (W32) t->base.blocksize);
+	if (TREE_SCHED(&t->base))
+		sha256sched(t->padW, t->pad);
+	Copy(pfx, t->block, pfxlen, UCHR);
+}
+
+/* treenode: writes digest of prefix||left||right to out */
+static void treenode(SHATREE *t, UCHR *left, UCHR *right, UCHR *out)
+{
+	SHA s;
+	UINT dlen = t->base.digestlen;
+
+	Copy(&t->base, &s, 1, SHA);
+	if (t->oneblock) {
+		if (t->pfxlen == 0 && right == left + dlen)
+			s.sha(&s, left);
+		else {
+			Copy(left, t->block + t->pfxlen, dlen, UCHR);
+			Copy(right, t->block + t->pfxlen + dlen, dlen, UCHR);
+			s.sha(&s, t->block);
+		}
+		if (TREE_SCHED(&s))
+			sha256w(&s, t->padW);
+		else
+			s.sha(&s, t->pad);
+	}
+	else {
+		shawrite(t->pfx, (ULNG) t->pfxlen << 3, &s);
+		shawrite(left, (ULNG) dlen << 3, &s);
+		shawrite(right, (ULNG) dlen << 3, &s);
+		shafinish(&s);
+	}
+	Copy(digcpy(&s), out, dlen, UCHR);
+}
+
+/* treeroot: reduces n digests in buf to the root (left in buf), pairing
+ * neighbours level by level and promoting an unpaired last node; if
+ * idx < n, the sibling digests along idx's path are written to proof,
+ * and their count is returned */
+static UINT treeroot(SHATREE *t, UCHR *buf, ULNG n, ULNG idx, UCHR *proof)
+{
+	ULNG i;
+	UINT dlen = t->base.digestlen;
+	UINT nproof = 0;
+	int wantproof = idx < n;
+	UCHR node[SHA_MAX_DIGEST_BITS/8];
+
+	while (n > 1) {
+		if (wantproof && (idx ^ 1) < n && nproof < SHA_TREE_MAX_DEPTH)
+			Copy(buf + (idx ^ 1) * dlen,
+				proof + nproof++ * dlen, dlen, UCHR);
+		for (i = 0; i + 1 < n; i += 2) {
+			treenode(t, buf + i * dlen, buf + (i+1) * dlen, node);
+			Copy(node, buf + (i >> 1) * dlen, dlen, UCHR);
+		}
+		if (n & 1)
+			Move(buf + (n-1) * dlen, buf + (n >> 1) * dlen,
+				dlen, UCHR);
+		n = (n + 1) >> 1;
+		idx >>= 1;
+	}
+	return(nproof);
+}
@@ -0,0 +1,57 @@
+use strict;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha256_hex));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no add_list method\n";
+		exit;
+	}
+}
+
+package P1;
+use vars qw(@ISA);
+@ISA = ($MODULE);
+
+package main;
+
+print "1..5\n";
+
+my @chunks = map { "line $_\n" } (1 .. 1000);
+my $rsp = sha256_hex(@chunks);
+
+my $testnum = 1;
+print "not " unless
+	$MODULE->new(256)->add_list(\@chunks)->hexdigest eq $rsp;
+print "ok ", $testnum++, "\n";
+
+print "not " unless $MODULE->new(256)->add_list([])->add_list(\@chunks)
+	->add_list([""])->hexdigest eq $rsp;
+print "ok ", $testnum++, "\n";
+
+print "not " if defined $MODULE->new(256)->add_list("not an array");
+print "ok ", $testnum++, "\n";
+
+	# subclassed and cloned objects
+
+print "not " unless
+	P1->new(256)->clone->add_list(\@chunks)->hexdigest eq $rsp;
+print "ok ", $testnum++, "\n";
+
+	# non-objects are rejected
+
+print "not " if defined $MODULE->hashsize;
+print "ok ", $testnum++, "\n";
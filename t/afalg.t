@@ -0,0 +1,102 @@
+use strict;
+use FileHandle;
+use POSIX ();
+use Socket;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw());
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no kernel backend\n";
+		exit;
+	}
+}
+
+	# whether or not AF_ALG is usable here, results must not
+	# depend on the backend switch
+
+my @alg = (1, 224, 256, 384, 512, 512224, 512256);
+
+my $numtests = 2 * scalar(@alg) + 1;
+print "1..$numtests\n";
+
+my ($infile, $outfile) = ("afalg.in", "afalg.out");
+END { 1 while unlink $infile; 1 while unlink $outfile }
+
+my $data = join("", map { chr($_ % 241) } (0 .. 300000));
+my $fh = FileHandle->new($infile, "w");
+binmode($fh);
+print $fh $data;
+$fh->close;
+
+sub copyhash {
+	my $alg = shift;
+	local (*IN, *OUT);
+	open(IN, "<$infile");
+	open(OUT, ">$outfile");
+	binmode(IN); binmode(OUT);
+	my ($n, $digest) = Digest::SHA::copy_and_hash(*IN, *OUT, alg => $alg);
+	close(IN); close(OUT);
+	return($n == length($data) ? $digest : "");
+}
+
+my $testnum = 1;
+for my $alg (@alg) {
+	my $fcn = $MODULE->can("sha${alg}_hex");
+	my $rsp = $MODULE->new($alg)->add($data)->hexdigest;
+	my @out;
+	for my $on (1, 0) {
+		Digest::SHA::_afalg($on);
+		push(@out, $fcn->($data, "tail"), unpack("H*", copyhash($alg)));
+	}
+	Digest::SHA::_afalg(1);
+	my $tail = $MODULE->new($alg)->add($data, "tail")->hexdigest;
+	print "not " unless $out[0] eq $tail && $out[2] eq $tail;
+	print "ok ", $testnum++, "\n";
+	print "not " unless $out[1] eq $rsp && $out[3] eq $rsp;
+	print "ok ", $testnum++, "\n";
+}
+
+	# the cached transform sockets may have been closed behind our
+	# back and their numbers reused: a listening socket there must
+	# keep its pending connection
+
+my $usable = Digest::SHA::kernels()->{sha256}{afalg};
+my $ok = 1;
+if ($usable) {
+	local (*L, *C);
+	socket(L, PF_INET, SOCK_STREAM, getprotobyname('tcp'));
+	bind(L, sockaddr_in(0, INADDR_LOOPBACK));
+	listen(L, 5);
+	for my $n (3 .. 31) {
+		POSIX::dup2(fileno(L), $n) unless $n == fileno(L);
+	}
+	socket(C, PF_INET, SOCK_STREAM, getprotobyname('tcp'));
+	connect(C, getsockname(L));
+	for my $alg (@alg) {
+		my $fcn = $MODULE->can("sha${alg}_hex");
+		$ok &&= $fcn->($data) eq
+			$MODULE->new($alg)->add($data)->hexdigest;
+	}
+	my $rin = "";
+	vec($rin, fileno(L), 1) = 1;
+	$ok &&= select($rin, undef, undef, 2) > 0;
+	close(C);
+	POSIX::close($_) for grep { $_ != fileno(L) } (3 .. 31);
+	close(L);
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $usable ? "" : " # skip: AF_ALG unavailable", "\n";
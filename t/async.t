@@ -0,0 +1,112 @@
+use strict;
+use FileHandle;
+use Config;
+use POSIX ();
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw());
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no background hashing\n";
+		exit;
+	}
+}
+
+my @alg = (1, 224, 256, 384, 512, 512224, 512256);
+
+my $numtests = 4 + scalar @alg;
+print "1..$numtests\n";
+
+my $tempfile = "async.tmp";
+END { 1 while unlink $tempfile }
+
+my $data = join("", map { chr($_ % 251) } (0 .. 300000));
+my $fh = FileHandle->new($tempfile, "w");
+binmode($fh);
+print $fh $data;
+$fh->close;
+
+	# run one job per algorithm concurrently, each continuing
+	# from a partially-fed state
+
+my $testnum = 1;
+my @jobs = map { $MODULE->new($_)->add("abc")->addfile_async($tempfile) }
+	@alg;
+for my $alg (@alg) {
+	my $job = shift(@jobs);
+	my $rsp = $MODULE->new($alg)->add("abc", $data)->hexdigest;
+	print "not " unless $job->wait->hexdigest eq $rsp;
+	print "ok ", $testnum++, "\n";
+}
+
+	# readiness descriptor becomes readable on completion (jobs
+	# without one, under the synchronous fallback, are done already)
+
+my $sha = $MODULE->new(256);
+my $job = $sha->addfile_async($tempfile);
+my $nfound = 1;
+if (defined $job->fileno) {
+	my $rin = "";
+	vec($rin, $job->fileno, 1) = 1;
+	$nfound = select(my $rout = $rin, undef, undef, 30);
+}
+print "not " unless $nfound == 1 && $job->is_done;
+print "ok ", $testnum++, "\n";
+
+	# state is copied back into the original object
+
+$job->wait;
+print "not " unless $sha->hexdigest eq $MODULE->new(256)->add($data)->hexdigest;
+print "ok ", $testnum++, "\n";
+
+	# filehandle form reads the underlying descriptor
+
+open(FILE, "<$tempfile");
+binmode(FILE);
+print "not " unless
+	$MODULE->new(1)->addfile_async(*FILE)->wait->hexdigest eq
+	$MODULE->new(1)->add($data)->hexdigest;
+print "ok ", $testnum++, "\n";
+close(FILE);
+
+	# a child forked while a job is outstanding neither waits for
+	# the parent's worker thread nor disturbs the job
+
+my $skip = $^O eq 'MSWin32' || !$Config{d_fork} ? "no fork" : "";
+my $ok = 1;
+unless ($skip) {
+	my $sha = $MODULE->new(1);
+	my $job = $sha->addfile_async($tempfile);
+	my $pid = fork;
+	if (defined $pid && $pid == 0) {
+		my $kid = $job->is_done && (defined $job->fileno ?
+			!eval { $job->wait; 1 } && $@ =~ /another process/ :
+			1);
+		undef $job;
+		POSIX::_exit($kid ? 0 : 1);
+	}
+	if (defined $pid) {
+		local $SIG{ALRM} = sub { kill 9, $pid };
+		alarm(30);
+		waitpid($pid, 0);
+		alarm(0);
+		$ok = $? == 0 && $job->wait->hexdigest eq
+			$MODULE->new(1)->add($data)->hexdigest;
+	}
+	else { $ok = 0 }
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $skip ? " # skip: $skip" : "", "\n";
@@ -0,0 +1,90 @@
+use strict;
+use FileHandle;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha1 sha256 sha512));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no copy_and_hash\n";
+		exit;
+	}
+}
+
+my $numtests = 6;
+print "1..$numtests\n";
+
+my ($infile, $outfile) = ("copyhash.in", "copyhash.out");
+END { 1 while unlink $infile; 1 while unlink $outfile }
+
+my $data = join("", map { chr($_ % 253) } (0 .. 200000));
+my $fh = FileHandle->new($infile, "w");
+binmode($fh);
+print $fh $data;
+$fh->close;
+
+sub slurp {
+	my $file = shift;
+	local *F;
+	open(F, "<$file") or return "";
+	binmode(F);
+	local $/;
+	my $str = <F>;
+	close(F);
+	defined $str ? $str : "";
+}
+
+my $testnum = 1;
+
+	# filehandles, explicit algorithm
+
+open(IN, "<$infile");
+open(OUT, ">$outfile");
+binmode(IN); binmode(OUT);
+my ($n, $digest) = Digest::SHA::copy_and_hash(*IN, *OUT, alg => 256);
+close(IN); close(OUT);
+print "not " unless $n == length($data) && $digest eq sha256($data);
+print "ok ", $testnum++, "\n";
+print "not " unless slurp($outfile) eq $data;
+print "ok ", $testnum++, "\n";
+
+	# numeric descriptors, default algorithm
+
+open(IN, "<$infile");
+open(OUT, ">$outfile");
+($n, $digest) = Digest::SHA::copy_and_hash(fileno(IN), fileno(OUT));
+close(IN); close(OUT);
+print "not " unless $n == length($data) && $digest eq sha1($data);
+print "ok ", $testnum++, "\n";
+
+	# empty input
+
+open(IN, "</dev/null") or open(IN, "<nul");
+open(OUT, ">$outfile");
+($n, $digest) = Digest::SHA::copy_and_hash(*IN, *OUT, alg => "sha512");
+close(IN); close(OUT);
+print "not " unless $n == 0 && $digest eq sha512("");
+print "ok ", $testnum++, "\n";
+
+	# unknown algorithm
+
+print "not " if Digest::SHA::copy_and_hash(0, 1, alg => 42);
+print "ok ", $testnum++, "\n";
+
+	# unopened handle
+
+eval { Digest::SHA::copy_and_hash(*NOSUCH, *OUT) };
+print "not " unless $@ =~ /^Copy failed: \S/;
+print "ok ", $testnum++, "\n";
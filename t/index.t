@@ -0,0 +1,93 @@
+use strict;
+use FileHandle;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha1 sha1_hex sha256 sha256_hex));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no Digest::SHA::Index\n";
+		exit;
+	}
+}
+
+use Digest::SHA::Index;
+
+my $numtests = 12;
+print "1..$numtests\n";
+
+my ($idxfile, $listfile) = ("index.idx", "index.lst");
+END { 1 while unlink $idxfile; 1 while unlink $listfile }
+
+my $testnum = 1;
+
+	# binary and hex digests, with duplicates
+
+my @known = map { sha256($_) } (0 .. 4999);
+my $idx = Digest::SHA::Index->build($idxfile,
+		[@known, map { sha256_hex($_) } (0 .. 99)]);
+
+print "not " unless $idx && $idx->count == 5000 && $idx->digestlen == 32;
+print "ok ", $testnum++, "\n";
+print "not " if grep { !$idx->contains($_) } @known;
+print "ok ", $testnum++, "\n";
+print "not " unless $idx->contains(uc unpack("H*", $known[1234]));
+print "ok ", $testnum++, "\n";
+print "not " if grep { $idx->contains(sha256($_)) } (5000 .. 5999);
+print "ok ", $testnum++, "\n";
+print "not " if defined $idx->contains(sha1("abc"));
+print "ok ", $testnum++, "\n";
+
+	# reopen from disk
+
+undef $idx;
+$idx = Digest::SHA::Index->new($idxfile);
+print "not " unless $idx && $idx->contains($known[4999]) &&
+	!$idx->contains(sha256("abc"));
+print "ok ", $testnum++, "\n";
+
+	# list file with surrounding text, as in NSRL-style CSV
+
+my $fh = FileHandle->new($listfile, "w");
+print $fh qq("SHA-1","FileName"\n);
+print $fh qq("@{[uc sha1_hex($_)]}","file$_.txt"\n) for (1 .. 300);
+$fh->close;
+$idx = Digest::SHA::Index->build($idxfile, $listfile);
+print "not " unless $idx->count == 300 && $idx->digestlen == 20 &&
+	$idx->contains(sha1(300)) && !$idx->contains(sha1(301));
+print "ok ", $testnum++, "\n";
+
+	# empty index
+
+$idx = Digest::SHA::Index->build($idxfile, []);
+print "not " unless $idx->count == 0 && !$idx->contains(sha1("abc"));
+print "ok ", $testnum++, "\n";
+
+	# malformed input
+
+print "not " if eval { Digest::SHA::Index->build($idxfile, ["xyz"]) };
+print "ok ", $testnum++, "\n";
+$! = 22;
+eval { Digest::SHA::Index->build($idxfile, ["zz"]) };
+print "not " unless $@ =~ /^Malformed digest at item 1 at /;
+print "ok ", $testnum++, "\n";
+print "not " if eval { Digest::SHA::Index->build($idxfile,
+	[sha1("a"), sha256("a")]) };
+print "ok ", $testnum++, "\n";
+
+	# not an index
+
+print "not " if Digest::SHA::Index->new($listfile);
+print "ok ", $testnum++, "\n";
@@ -0,0 +1,137 @@
+use strict;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha1 sha1_hex sha256 sha256_hex sha512_base64
+		sha512224 sha512224_hex sha512256 hmac_sha256_hex));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no digest_into\n";
+		exit;
+	}
+}
+
+my $skip = $] < 5.008 ? 1 : 0;
+
+my $numtests = 13;
+print "1..$numtests\n";
+
+my $testnum = 1;
+
+	# digest_into: binary, hex, and base64 results in one target
+
+my $data = join("", map { chr($_ % 256) } (0 .. 99999));
+my $out = "";
+my $ret = Digest::SHA::digest_into($out, 256, $data);
+print "not " unless $out eq sha256($data) && $ret eq $out;
+print "ok ", $testnum++, "\n";
+Digest::SHA::digest_into($out, "sha1_hex", "ab", "c");
+print "not " unless $out eq sha1_hex("abc");
+print "ok ", $testnum++, "\n";
+Digest::SHA::digest_into($out, "SHA-512_base64", $data);
+print "not " unless $out eq sha512_base64($data);
+print "ok ", $testnum++, "\n";
+print "not " if defined Digest::SHA::digest_into($out, 42, $data);
+print "ok ", $testnum++, "\n";
+
+	# the SHA-512/t names select their algorithms as in new()
+
+Digest::SHA::digest_into($out, "sha512/224_hex", $data);
+print "not " unless $out eq sha512224_hex($data) &&
+	Digest::SHA::digest_into($out, "512224", $data) eq sha512224($data);
+print "ok ", $testnum++, "\n";
+Digest::SHA::digest_into($out, "sha512/256", $data);
+print "not " unless $out eq sha512256($data) &&
+	Digest::SHA::digest_into($out, "512256", $data) eq $out;
+print "ok ", $testnum++, "\n";
+
+	# results are distinct scalars, even from the same call site
+
+my @d = map { sha1_hex($_) } (1 .. 3);
+print "not " unless $d[0] ne $d[1] && $d[1] ne $d[2] &&
+	$d[2] eq sha1_hex(3);
+print "ok ", $testnum++, "\n";
+
+	# UTF-8 input is hashed as bytes, and left as it was
+
+my ($str, $bytes, $ok) = ("", "", 1);
+unless ($skip) {
+	$bytes = join("", map { chr($_ % 256) } (0 .. 40000));
+	$str = $bytes;
+	utf8::upgrade($str);
+	$ok = sha256_hex($str) eq sha256_hex($bytes)
+		&& $MODULE->new(1)->add($str)->digest eq sha1($bytes)
+		&& utf8::is_utf8($str);
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $skip ? " # skip: no utf8::upgrade" : "", "\n";
+
+unless ($skip) {
+	my $key = "k\x{e9}y";
+	my $kbytes = $key;
+	utf8::upgrade($key);
+	$ok = hmac_sha256_hex($str, $key) eq hmac_sha256_hex($bytes, $kbytes)
+		&& utf8::is_utf8($key);
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $skip ? " # skip: no utf8::upgrade" : "", "\n";
+
+	# mostly-ASCII UTF-8, as in JSON text
+
+unless ($skip) {
+	$bytes = join("", map { "\"key$_\": \"caf\xe9 $_\", " } (1 .. 500));
+	$str = $bytes;
+	utf8::upgrade($str);
+	$ok = sha1($str) eq sha1($bytes) && utf8::is_utf8($str);
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $skip ? " # skip: no utf8::upgrade" : "", "\n";
+
+	# wide characters still croak, without touching the input
+
+unless ($skip) {
+	$str = "abc" . chr(256);
+	$ok = !eval { sha1($str); 1 } && $@ =~ /Wide character/ &&
+		$str eq "abc" . chr(256);
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $skip ? " # skip: no utf8::upgrade" : "", "\n";
+
+	# ... nor the object's state, even after long ASCII runs
+
+unless ($skip) {
+	my $sha = $MODULE->new(1);
+	$ok = !eval { $sha->add("abc" . "x" x 100 . chr(300)); 1 } &&
+		$sha->hexdigest eq sha1_hex("");
+	$sha->add("ab");
+	$ok &&= !eval { $sha->add("c" . ("\xe9" x 5000) . chr(300)); 1 } &&
+		$sha->hexdigest eq sha1_hex("ab");
+}
+print "not " unless $ok;
+print "ok ", $testnum++, $skip ? " # skip: no utf8::upgrade" : "", "\n";
+
+	# tied arguments are fetched once, even when large enough for AF_ALG
+
+package Counted;
+sub TIESCALAR { my ($class, $val) = @_; bless { val => $val, n => 0 } }
+sub FETCH { $_[0]->{n}++; $_[0]->{val} }
+package main;
+
+my $obj = tie my $tied, 'Counted', $data;
+$ok = sha256($tied) eq sha256($data) && $obj->{n} == 1;
+Digest::SHA::digest_into($out, "sha1_hex", "x", $tied);
+$ok &&= $out eq sha1_hex("x" . $data) && $obj->{n} == 2;
+print "not " unless $ok;
+print "ok ", $testnum++, "\n";
@@ -0,0 +1,108 @@
+use strict;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(hmac_sha256 merkle_root));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has a single kernel\n";
+		exit;
+	}
+}
+
+	# Every compiled kernel must agree with the default one on
+	# random inputs, and pass the standard vectors in t/
+
+my @alg = (1, 224, 256, 384, 512, 512224, 512256);
+my @vectors = grep { -f $_ } map { -d "t" ? "t/$_" : $_ }
+	qw(fips180-4.t nistbit.t nistbyte.t gglong.t);
+
+my $kernels = Digest::SHA::kernels();
+my (%alt, $numtests);
+for my $alg (@alg) {
+	my $k = $kernels->{"sha$alg"} or next;
+	$numtests++;
+	$alt{$_}++ for grep { $_ ne $k->{available}[0] } @{$k->{available}};
+}
+$numtests += @vectors * keys(%alt) + 1;
+print "1..$numtests\n";
+
+my $seed = defined $ENV{SHA_KERNEL_SEED} ? $ENV{SHA_KERNEL_SEED} : time;
+srand($seed);
+print "# random seed $seed (set SHA_KERNEL_SEED to repeat)\n";
+
+	# inputs straddle block boundaries, and include partial bytes
+
+my @msgs;
+for my $len (0 .. 300, map { int(rand(20000)) } (1 .. 20)) {
+	push(@msgs, join("", map { chr(int(rand(256))) } (1 .. $len)));
+}
+
+sub digests {
+	my $alg = shift;
+	my @d;
+	for my $msg (@msgs) {
+		my $sha = $MODULE->new($alg)->add($msg);
+		push(@d, $sha->clone->digest);
+		$sha->add_bits(unpack("B*", $msg), length($msg) % 8 + 1);
+		push(@d, $sha->digest);
+	}
+	push(@d, merkle_root([@d[0 .. 40]], alg => $alg));
+	push(@d, hmac_sha256($msgs[-1], $msgs[-2])) if $alg == 256;
+	join("", @d);
+}
+
+my $testnum = 1;
+for my $alg (@alg) {
+	my $k = $kernels->{"sha$alg"} or next;
+	my ($default, @others) = @{$k->{available}};
+	Digest::SHA::_setkernel($alg, $default);
+	my $want = digests($alg);
+	my @bad = grep { Digest::SHA::_setkernel($alg, $_);
+		digests($alg) ne $want } @others;
+	Digest::SHA::_setkernel($alg, $k->{selected});
+	print "# sha$alg kernel(s) @bad differ from $default\n" if @bad;
+	print "not " if @bad;
+	print "ok ", $testnum++, "\n";
+}
+
+	# rerun the vector scripts with each non-default kernel forced
+
+for my $kernel (sort keys %alt) {
+	local $ENV{PERL_DIGEST_SHA_KERNEL} = $kernel;
+	for my $script (@vectors) {
+		my @out = `"$^X" ${\ join(" ", map { qq("-I$_") } @INC)} $script`;
+		my $ok = $? == 0 && !grep { /^not ok/ } @out;
+		print "# $script failed with kernel $kernel\n" unless $ok;
+		print "not " unless $ok;
+		print "ok ", $testnum++, "\n";
+	}
+}
+
+	# override names are parsed as in new(): "sha512/256" is not SHA-256
+
+{
+	my @warned;
+	local $SIG{__WARN__} = sub { push(@warned, @_) };
+	my $before = $kernels->{sha256}{selected};
+	Digest::SHA::_envkernels("sha512/256=sched");
+	my $ok = @warned == 1 &&
+		Digest::SHA::kernels()->{sha256}{selected} eq $before;
+	Digest::SHA::_envkernels("SHA-256=c");
+	$ok &&= @warned == 1 && Digest::SHA::kernels()->{sha256}{selected} eq "c";
+	Digest::SHA::_setkernel(256, $before);
+	print "not " unless $ok;
+	print "ok ", $testnum++, "\n";
+}
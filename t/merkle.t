@@ -0,0 +1,102 @@
+use strict;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha1 sha224 sha256 sha512));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no Merkle routines\n";
+		exit;
+	}
+}
+
+	# reference Merkle Tree Hash, following RFC 6962 section 2.1
+
+sub mth {
+	my ($h, $np, @d) = @_;
+	return $h->("") unless @d;
+	return $d[0] if @d == 1;
+	my $k = 1;
+	$k <<= 1 while ($k << 1) < @d;
+	$h->($np . mth($h, $np, @d[0 .. $k-1]) .
+		mth($h, $np, @d[$k .. $#d]));
+}
+
+	# recomputes the root from a leaf and its audit path
+
+sub fromproof {
+	my ($h, $np, $m, $n, $node, @path) = @_;
+	return $node if $n == 1;
+	my $k = 1;
+	$k <<= 1 while ($k << 1) < $n;
+	my $sib = pop(@path);
+	return undef unless defined $sib;
+	return $h->($np . fromproof($h, $np, $m, $k, $node, @path) . $sib)
+		if $m < $k;
+	$h->($np . $sib . fromproof($h, $np, $m-$k, $n-$k, $node, @path));
+}
+
+my @cases = (
+	[1,   \&sha1,   undef,  ""    ],
+	[224, \&sha224, "\x00", "\x01"],
+	[224, \&sha224, undef,  "\x02" x 8],
+	[256, \&sha256, undef,  ""    ],
+	[256, \&sha256, "\x00", "\x01"],
+	[512, \&sha512, undef,  ""    ],
+	[256, \&sha256, undef,  "\x03" x 100],
+	[1,   \&sha1,   "\x00", "\x04" x 300],
+);
+my @sizes = (0 .. 9, 31, 33);
+
+my $numtests = 3 + 2 * scalar(@cases);
+print "1..$numtests\n";
+
+my $testnum = 1;
+for my $case (@cases) {
+	my ($alg, $h, $lp, $np) = @$case;
+	my %opts = (alg => $alg, node_prefix => $np);
+	$opts{leaf_prefix} = $lp if defined $lp;
+
+	my ($rootok, $proofok) = (1, 1);
+	for my $n (@sizes) {
+		my @leaves = map { defined $lp ? "leaf $_" : $h->($_) }
+			(1 .. $n);
+		my @d = map { defined $lp ? $h->($lp . $_) : $_ } @leaves;
+		my $root = Digest::SHA::merkle_root(\@leaves, %opts);
+		$rootok = 0 unless $root eq mth($h, $np, @d);
+		for my $m (0 .. $n - 1) {
+			my @path = Digest::SHA::merkle_proof(\@leaves,
+				$m, %opts);
+			my $r = fromproof($h, $np, $m, $n, $d[$m], @path);
+			$proofok = 0 unless defined $r && $r eq $root;
+		}
+	}
+	print "not " unless $rootok;
+	print "ok ", $testnum++, "\n";
+	print "not " unless $proofok;
+	print "ok ", $testnum++, "\n";
+}
+
+	# malformed leaves, bad index, and bad algorithm
+
+print "not " unless !defined eval {
+	Digest::SHA::merkle_root(["short"], alg => 256) };
+print "ok ", $testnum++, "\n";
+
+print "not " if Digest::SHA::merkle_proof([sha1("a")], 1);
+print "ok ", $testnum++, "\n";
+
+print "not " if defined Digest::SHA::merkle_root([], alg => 42);
+print "ok ", $testnum++, "\n";
@@ -0,0 +1,78 @@
+use strict;
+use Fcntl;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha1 sha256));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+my $numtests = 4;
+print "1..$numtests\n";
+
+my $file = "sparse.tmp";
+END { 1 while unlink $file }
+
+	# mksparse($size, $offset => $data, ...): writes a file whose
+	# unwritten ranges are holes (on file systems supporting them),
+	# returning the equivalent string
+
+sub mksparse {
+	my ($size, %chunks) = @_;
+
+	my $str = "\0" x $size;
+	local *F;
+	sysopen(F, $file, O_WRONLY|O_CREAT|O_TRUNC) or die "$file: $!";
+	binmode(F);
+	for my $off (sort { $a <=> $b } keys %chunks) {
+		sysseek(F, $off, 0);
+		syswrite(F, $chunks{$off});
+		substr($str, $off, length($chunks{$off})) = $chunks{$off};
+	}
+	truncate(F, $size);
+	close(F);
+	$str;
+}
+
+my $data = join("", map { chr($_ % 256) } (0 .. 9999));
+my $testnum = 1;
+
+	# leading, interior, and trailing holes
+
+my $str = mksparse(3 << 20, (1 << 20) + 13 => $data, (2 << 20) => "end");
+print "not " unless $MODULE->new(256)->addfile($file)->digest
+	eq sha256($str);
+print "ok ", $testnum++, "\n";
+
+	# data at both ends, with a state already holding partial input
+
+$str = mksparse(3 << 20, 0 => $data, (3 << 20) - 5 => "tail!");
+print "not " unless $MODULE->new(1)->add("abc")->addfile($file, "b")->digest
+	eq sha1("abc" . $str);
+print "ok ", $testnum++, "\n";
+
+	# all hole
+
+$str = mksparse(1 << 20);
+print "not " unless $MODULE->new(256)->addfile($file)->digest
+	eq sha256($str);
+print "ok ", $testnum++, "\n";
+
+	# background job
+
+if ($MODULE->can("addfile_async")) {
+	$str = mksparse(2 << 20, 77777 => $data);
+	my $sha = $MODULE->new(256);
+	$sha->addfile_async($file)->wait;
+	print "not " unless $sha->digest eq sha256($str);
+}
+print "ok ", $testnum++, "\n";
@@ -0,0 +1,151 @@
+use strict;
+use FileHandle;
+
+my $MODULE;
+
+BEGIN {
+	$MODULE = (-d "src") ? "Digest::SHA" : "Digest::SHA::PurePerl";
+	eval "require $MODULE" || die $@;
+	$MODULE->import(qw(sha1 sha256));
+}
+
+BEGIN {
+	if ($ENV{PERL_CORE}) {
+		chdir 't' if -d 't';
+		@INC = '../lib';
+	}
+}
+
+BEGIN {
+	if ($MODULE ne "Digest::SHA") {
+		print "1..0 # Skipped: $MODULE has no addtar\n";
+		exit;
+	}
+}
+
+my $numtests = 7;
+print "1..$numtests\n";
+
+my $file = "tar.tmp";
+END { 1 while unlink $file }
+
+	# header($name, $type, $size [, $prefix]): builds a ustar header
+
+sub header {
+	my ($name, $type, $size, $prefix) = @_;
+
+	my $h = pack("a100 a8 a8 a8 a12 a12 a8 a1 a100 a6 a2 a32 a32 a8 a8 a155 a12",
+		$name, "0000644", "0000000", "0000000",
+		sprintf("%011o", $size), "00000000000", " " x 8, $type,
+		"", "ustar", "00", "", "", "", "", defined $prefix ?
+		$prefix : "", "");
+	my $sum = unpack("%32C*", $h);
+	substr($h, 148, 8) = sprintf("%06o\0 ", $sum);
+	$h;
+}
+
+sub member {
+	my ($name, $type, $data, $prefix) = @_;
+
+	my $pad = (512 - length($data) % 512) % 512;
+	header($name, $type, length($data), $prefix) . $data . "\0" x $pad;
+}
+
+sub pax {
+	my %kv = @_;
+
+	my $recs = "";
+	for (sort keys %kv) {
+		my $r = " $_=$kv{$_}\n";
+		my $n = length($r) + 1;
+		$n++ while length($n . $r) > $n;
+		$recs .= $n . $r;
+	}
+	member("PaxHeader", "x", $recs);
+}
+
+my $long = "dir/" . ("n" x 150) . ".txt";
+my $big = join("", map { chr($_ % 251) } (0 .. 70000));
+my $tar = member("dir/", "5", "")
+	. member("dir/a.txt", "0", "abc")
+	. member("empty", "0", "")
+	. member("././\@LongLink", "L", "$long\0")
+	. member("dir/truncated-name", "0", $big)
+	. member("link", "2", "")
+	. pax(path => "pax/" . ("p" x 120), size => 5)
+	. member("ignored", "0", "hello")
+	. member("b.bin", "0", "xyz", "some/prefix")
+	. "\0" x 1024;
+
+my $fh = FileHandle->new($file, "w");
+binmode($fh);
+print $fh $tar;
+$fh->close;
+
+my @want = (
+	["dir/a.txt", sha256("abc")],
+	["empty", sha256("")],
+	[$long, sha256($big)],
+	["pax/" . ("p" x 120), sha256("hello")],
+	["some/prefix/b.bin", sha256("xyz")],
+);
+
+sub same {
+	my ($got, $want) = @_;
+	return 0 unless @$got == @$want;
+	for (0 .. $#$want) {
+		return 0 unless $got->[$_][0] eq $want->[$_][0];
+		return 0 unless $got->[$_][1] eq $want->[$_][1];
+	}
+	1;
+}
+
+my $testnum = 1;
+
+	# members and whole archive from a filename
+
+my $sha = Digest::SHA->new(256);
+my @got = $sha->addtar($file);
+print "not " unless same(\@got, \@want);
+print "ok ", $testnum++, "\n";
+print "not " unless $sha->digest eq sha256($tar);
+print "ok ", $testnum++, "\n";
+
+	# from a filehandle, with another algorithm
+
+$sha = Digest::SHA->new(1);
+open(FH, "<$file");
+@got = $sha->addtar(*FH);
+close(FH);
+print "not " unless @got == 5 && $got[2][1] eq sha1($big);
+print "ok ", $testnum++, "\n";
+print "not " unless $sha->digest eq sha1($tar);
+print "ok ", $testnum++, "\n";
+
+	# archive without end-of-archive blocks
+
+$fh = FileHandle->new($file, "w");
+binmode($fh);
+print $fh member("x", "0", "abc");
+$fh->close;
+@got = Digest::SHA->new(256)->addtar($file);
+print "not " unless @got == 1 && $got[0][1] eq sha256("abc");
+print "ok ", $testnum++, "\n";
+
+	# truncated member and bad checksum
+
+$fh = FileHandle->new($file, "w");
+binmode($fh);
+print $fh substr($tar, 0, 3000);
+$fh->close;
+print "not " if eval { Digest::SHA->new->addtar($file); 1 };
+print "ok ", $testnum++, "\n";
+
+my $bad = member("x", "0", "abc");
+substr($bad, 0, 1) = "y";
+$fh = FileHandle->new($file, "w");
+binmode($fh);
+print $fh $bad;
+$fh->close;
+print "not " if eval { Digest::SHA->new->addtar($file); 1 };
+print "ok ", $testnum++, "\n";